@@ -0,0 +1,248 @@
+#include "ofMain.h"
+#include "Aquarium.h"
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <thread>
+
+// Microbenchmarks for the simulation hot paths. Every benchmark reports the time per
+// call and the number of global operator new calls per call, so a regression in
+// either shows up when comparing runs across releases.
+//
+//   bench [--max-population N] [--min-time SECONDS] [--threads T] [--kernels avx2|sse2|scalar] [--csv]
+
+static std::atomic<long> g_allocations{0};
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+
+struct BenchResult {
+    std::string name;
+    int population;
+    long ops;
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+static double g_minTime = 0.25;
+static bool g_csv = false;
+static int g_threads = (int)std::max(1u, std::thread::hardware_concurrency());
+static const MoveKernels* g_kernels = &MoveKernels::best();
+
+// Runs op() in doubling batches until g_minTime has passed or maxOps calls were made.
+// op() returns false once it cannot run again (e.g. the aquarium is empty).
+template <class Op>
+BenchResult measure(const std::string& name, int population, long maxOps, Op&& op) {
+    using clock = std::chrono::steady_clock;
+    long ops = 0;
+    bool exhausted = false;
+    const long allocsBefore = g_allocations.load();
+    const auto start = clock::now();
+    double elapsed = 0.0;
+    for (long batch = 1; !exhausted && ops < maxOps && elapsed < g_minTime; batch *= 2) {
+        for (long i = 0; i < batch && ops < maxOps; ++i) {
+            if (!op()) { exhausted = true; break; }
+            ++ops;
+        }
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    const long allocs = g_allocations.load() - allocsBefore;
+    BenchResult r{name, population, ops, 0.0, 0.0};
+    if (ops > 0) {
+        r.nsPerOp = elapsed * 1e9 / ops;
+        r.allocsPerOp = (double)allocs / ops;
+    }
+    return r;
+}
+
+static void report(const BenchResult& r) {
+    if (g_csv) {
+        printf("%s,%d,%ld,%.1f,%.3f\n", r.name.c_str(), r.population, r.ops, r.nsPerOp, r.allocsPerOp);
+    } else {
+        printf("%-34s %9d %10ld %14.1f %12.3f\n", r.name.c_str(), r.population, r.ops, r.nsPerOp, r.allocsPerOp);
+    }
+    fflush(stdout);
+}
+
+
+// Level_5's species mix scaled to `population` fish, with a target score that is never reached
+class BenchLevel : public AquariumLevel {
+public:
+    BenchLevel(int population) : AquariumLevel(0, INT_MAX) {
+        const AquariumCreatureType types[] = {
+            AquariumCreatureType::NPCreature, AquariumCreatureType::BiggerFish, AquariumCreatureType::PufferFish,
+            AquariumCreatureType::Angelfish, AquariumCreatureType::Surgeonfish,
+        };
+        const int mix[] = {22, 10, 6, 8, 8};
+        int assigned = 0;
+        for (int i = 4; i >= 0; --i) {
+            int count = (i == 0) ? population - assigned : (int)((long long)population * mix[i] / 54);
+            assigned += count;
+            setPopulation(types[i], count);
+        }
+    }
+};
+
+// The tank grows with the population so fish density stays at Level_5's
+struct BenchTank {
+    std::shared_ptr<AquariumSpriteManager> sprites;
+    std::shared_ptr<Aquarium> aquarium;
+    std::shared_ptr<PlayerCreature> player;
+};
+
+static BenchTank makeTank(int population) {
+    srand(1);
+    GameRandom::seed(1);
+    const float scale = std::sqrt(std::max(1.0f, population / 54.0f));
+    const int width = (int)(1024 * scale);
+    const int height = (int)(768 * scale);
+    WorldBounds::set(width, height);
+
+    BenchTank tank;
+    tank.sprites = std::make_shared<AquariumSpriteManager>();
+    tank.aquarium = std::make_shared<Aquarium>(width, height, tank.sprites);
+    tank.aquarium->setMoveKernels(*g_kernels);
+    tank.aquarium->addAquariumLevel(std::make_shared<BenchLevel>(population));
+    tank.aquarium->setSpawnBudget(0); // the whole population up front, then the game's budget
+    tank.aquarium->Repopulate();
+    tank.aquarium->setSpawnBudget(Aquarium::kDefaultSpawnBudget);
+    tank.player = std::make_shared<PlayerCreature>(width/2 - 50, height/2 - 50, 5, tank.sprites->GetSprite(AquariumCreatureType::NPCreature));
+    tank.player->setCollisionRadius(35.0f);
+    tank.player->setBounds(width - 20, height - 20);
+    return tank;
+}
+
+static AquariumCreatureType speciesAt(long i) {
+    return static_cast<AquariumCreatureType>(i % 5);
+}
+
+
+int main(int argc, char* argv[]) {
+    int maxPopulation = 1000000;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--max-population") && i + 1 < argc) maxPopulation = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) g_minTime = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) g_threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--kernels") && i + 1 < argc) {
+            g_kernels = MoveKernels::find(argv[++i]);
+            if (g_kernels == nullptr) {
+                fprintf(stderr, "move kernels '%s' are not available on this CPU\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--csv")) g_csv = true;
+    }
+    ofSetLogLevel(OF_LOG_WARNING);
+
+    if (g_csv) {
+        printf("benchmark,population,ops,ns_per_op,allocs_per_op\n");
+    } else {
+        printf("move kernels: %s\n", g_kernels->name);
+        printf("%-34s %9s %10s %14s %12s\n", "benchmark", "fish", "ops", "ns/op", "allocs/op");
+    }
+
+    {
+        BenchTank tank = makeTank(54);
+        std::shared_ptr<Creature> a = tank.player;
+        std::shared_ptr<Creature> b = tank.aquarium->getCreatureAt(0);
+        volatile int sink = 0;
+        report(measure("checkCollision", 2, LONG_MAX, [&] { sink = sink + checkCollision(a, b); return true; }));
+    }
+
+    const int populations[] = {54, 1000, 10000, 100000, 1000000};
+    for (int population : populations) {
+        if (population > maxPopulation) break;
+
+        {
+            BenchTank tank = makeTank(population);
+            GameEventQueue events;
+            report(measure("DetectAquariumCollisions", population, LONG_MAX, [&] {
+                events.clear();
+                return DetectAquariumCollisions(tank.aquarium, tank.player, events) >= 0;
+            }));
+            {
+                // one schooling lookup, as Aquarium::update does for every NPCreature and Angelfish
+                const CollisionGrid& grid = tank.aquarium->getCollisionGrid();
+                const CreatureStore& store = tank.aquarium->getStore();
+                size_t i = 0;
+                volatile int sink = 0;
+                report(measure("CollisionGrid::forEachNeighbour", population, LONG_MAX, [&] {
+                    const size_t row = i++ % store.size();
+                    int found = 0;
+                    grid.forEachNeighbour(store.species[row], store.x[row] + store.radius[row], store.y[row] + store.radius[row],
+                                          Aquarium::kSchoolRadius, [&](int, float, float, float, float) { ++found; });
+                    sink = sink + found;
+                    return true;
+                }));
+            }
+            report(measure("Aquarium::update", population, LONG_MAX, [&] { tank.aquarium->update(); return true; }));
+            if (g_threads > 1) {
+                tank.aquarium->setUpdateThreads(g_threads);
+                report(measure("Aquarium::update x" + std::to_string(g_threads) + " threads", population, LONG_MAX,
+                               [&] { tank.aquarium->update(); return true; }));
+                tank.aquarium->setUpdateThreads(1);
+            }
+            report(measure("Aquarium::Repopulate", population, LONG_MAX, [&] { tank.aquarium->Repopulate(); return true; }));
+        }
+        {
+            BenchLevel level(population);
+            int missing[kCreatureTypeCount];
+            level.Repopulate(missing); // fill the counters so there is something to consume
+            long i = 0;
+            report(measure("AquariumLevel::ConsumePopulation", population, population, [&] {
+                level.ConsumePopulation(speciesAt(i++), 1);
+                return true;
+            }));
+        }
+        {
+            BenchTank tank = makeTank(population);
+            report(measure("Aquarium::removeCreature", population, population, [&] {
+                const int count = tank.aquarium->getCreatureCount();
+                if (count == 0) return false;
+                tank.aquarium->removeCreature(tank.aquarium->getCreatureHandle(rand() % count));
+                return true;
+            }));
+        }
+        {
+            BenchTank tank = makeTank(population);
+            long i = 0;
+            report(measure("Aquarium::SpawnCreature", population, population, [&] {
+                tank.aquarium->SpawnCreature(speciesAt(i++));
+                return true;
+            }));
+        }
+    }
+
+    {
+        // Once a tank has churned through a full population, spawns reuse the blocks that
+        // removes freed, so more spawn/remove cycles must not take another arena chunk
+        const int population = std::max(1, std::min(maxPopulation, 10000));
+        BenchTank tank = makeTank(population);
+        long i = 0;
+        auto churn = [&] {
+            for (int n = 0; n < population; ++n) {
+                tank.aquarium->removeCreature(tank.aquarium->getCreatureHandle(rand() % tank.aquarium->getCreatureCount()));
+                tank.aquarium->SpawnCreature(speciesAt(i++));
+            }
+        };
+        churn();
+        const size_t steady = tank.aquarium->getArena().heapAllocations();
+        for (int round = 0; round < 10; ++round) churn();
+        const size_t after = tank.aquarium->getArena().heapAllocations();
+        if (after != steady) {
+            fprintf(stderr, "arena grew from %zu to %zu chunks during spawn/remove cycles at a steady population of %d\n",
+                    steady, after, population);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include "ofMain.h"
+#include "Aquarium.h"
+#include "Replay.h"
+#include "Profiler.h"
+#include "Snapshot.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+// Headless runner: runs AquariumGameScene::Step() as fast as the CPU allows with
+// no window or GL context. Either the player swims a fixed pseudo-random pattern, or
+// a recorded game (data/replays/*.aqreplay) is played back and its final state hash
+// is checked against the one recorded. --trace writes the profiler zones of the last
+// Profiler::kHistoryFrames steps as Chrome trace JSON. --load starts from a saved
+// snapshot instead of a fresh tank, --save writes one after the last step. The levels
+// come from --settings (settings.xml next to the runner by default, the built-in levels
+// without one); a replay only plays back with the settings it was recorded with.
+//
+//   headless [--ticks N] [--seed S] [--width W] [--height H] [--threads T] [--trace FILE]
+//            [--load FILE] [--save FILE] [--settings FILE]
+//   headless --replay FILE [--threads T] [--trace FILE] [--settings FILE]
+int main(int argc, char* argv[]){
+
+	int ticks = 10000;
+	unsigned int seed = 1;
+	int width = 1024;
+	int height = 768;
+	int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+	const char* replayPath = nullptr;
+	const char* tracePath = nullptr;
+	const char* loadPath = nullptr;
+	const char* savePath = nullptr;
+	const char* settingsPath = "settings.xml";
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--ticks"))       ticks = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--seed"))   seed = (unsigned int)atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--width"))  width = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--height")) height = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--threads")) threads = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--replay")) replayPath = argv[i + 1];
+		else if (!strcmp(argv[i], "--trace"))  tracePath = argv[i + 1];
+		else if (!strcmp(argv[i], "--load"))   loadPath = argv[i + 1];
+		else if (!strcmp(argv[i], "--save"))   savePath = argv[i + 1];
+		else if (!strcmp(argv[i], "--settings")) settingsPath = argv[i + 1];
+	}
+
+	ofSetLogLevel(OF_LOG_WARNING);
+	Replay replay;
+	if (replayPath != nullptr) {
+		if (!replay.load(replayPath)) {
+			std::cerr << "could not read replay " << replayPath << std::endl;
+			return 2;
+		}
+		GameRandom::seed(replay.seed);
+		width = replay.width;
+		height = replay.height;
+		ticks = (int)replay.endTick;
+	} else {
+		srand(seed); // only the simulated player input still uses rand()
+		GameRandom::seed(seed);
+	}
+	WorldBounds::set(width, height);
+
+	// same setup as ofApp::setup, minus everything that needs a window
+	AquariumSettings settings = LoadAquariumSettings(settingsPath); // built-in levels if there is no such file
+	if (replayPath != nullptr && hashAquariumSettings(settings) != replay.settingsHash) {
+		std::cerr << "replay " << replayPath << " was recorded with different levels or player speed than " << settingsPath
+			<< " (the built-in levels if that file is missing); pass the settings.xml the game used with --settings" << std::endl;
+		return 2;
+	}
+	auto spriteManager = std::make_shared<AquariumSpriteManager>();
+	auto aquarium = std::make_shared<Aquarium>(width, height, spriteManager);
+	aquarium->setUpdateThreads(threads);
+	auto player = std::make_shared<PlayerCreature>(width/2 - 50, height/2 - 50, settings.playerSpeed, spriteManager->GetSprite(AquariumCreatureType::NPCreature));
+	player->setCollisionRadius(35.0f);
+	player->setDirection(0, 0);
+	player->setBounds(width - 20, height - 20);
+	if (replayPath == nullptr) {
+		player->setLives(1 << 30); // a load test should not end on game over
+	}
+
+	for (const auto& level : settings.levels) {
+		aquarium->addAquariumLevel(level);
+	}
+	aquarium->Repopulate();
+
+	if (loadPath != nullptr && replayPath == nullptr) {
+		auto loadStart = std::chrono::steady_clock::now();
+		if (!AquariumSnapshot::load(*aquarium, *player, loadPath)) {
+			std::cerr << "could not load snapshot " << loadPath << std::endl;
+			return 2;
+		}
+		WorldBounds::set(aquarium->getWidth(), aquarium->getHeight());
+		std::cout << "loaded " << aquarium->getCreatureCount() << " fish from " << loadPath << " in "
+			<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count() << " ms" << std::endl;
+	}
+
+	AquariumGameScene scene(player, aquarium, GameSceneKindToString(GameSceneKind::AQUARIUM_GAME));
+
+	size_t nextEvent = 0;
+	auto start = std::chrono::steady_clock::now();
+	int t = 0;
+	for (; t < ticks; ++t) {
+		Profiler::beginFrame(); // one step is one frame here
+		if (replayPath != nullptr) {
+			// what ofApp's key and resize handlers did before this Step()
+			for (; nextEvent < replay.events.size() && replay.events[nextEvent].tick <= (uint64_t)t; ++nextEvent) {
+				const ReplayEvent& e = replay.events[nextEvent];
+				switch (e.type) {
+					case ReplayEventType::KEY_PRESSED:  scene.HandleKeyPressed(e.a); break;
+					case ReplayEventType::KEY_RELEASED: scene.HandleKeyReleased(e.a); break;
+					case ReplayEventType::RESIZE:
+						WorldBounds::set(e.a, e.b);
+						aquarium->setBounds(e.a, e.b);
+						player->setBounds(e.a - 20, e.b - 20);
+						break;
+					case ReplayEventType::END: break;
+				}
+			}
+		} else if (t % 60 == 0) {
+			player->setDirection(rand() % 3 - 1, rand() % 3 - 1);
+		}
+		scene.Step();
+		if (scene.GetLastEvent().isGameOver()) {
+			++t;
+			break;
+		}
+	}
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const uint64_t hash = hashGameState(*aquarium, *player);
+	if (tracePath != nullptr) {
+		Profiler::beginFrame(); // closes the last step
+		if (!Profiler::writeChromeTrace(tracePath)) std::cerr << "could not write trace " << tracePath << std::endl;
+	}
+
+	std::cout << "ticks: " << t
+		<< "  seconds: " << secs
+		<< "  ticks/s: " << (secs > 0 ? t / secs : 0.0)
+		<< "  fish: " << aquarium->getCreatureCount()
+		<< "  score: " << player->getScore()
+		<< "  arena chunks: " << aquarium->getArena().heapAllocations() << std::endl;
+	printf("state hash: %016llx\n", (unsigned long long)hash);
+	if (savePath != nullptr && !AquariumSnapshot::save(*aquarium, *player, savePath)) {
+		std::cerr << "could not save snapshot " << savePath << std::endl;
+		return 2;
+	}
+
+	if (replayPath != nullptr) {
+		if (hash != replay.stateHash || (uint64_t)t != replay.endTick) {
+			printf("replay MISMATCH: recorded %016llx after %llu ticks\n",
+				(unsigned long long)replay.stateHash, (unsigned long long)replay.endTick);
+			return 1;
+		}
+		printf("replay OK\n");
+	}
+	return 0;
+}
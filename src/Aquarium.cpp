@@ -1,4 +1,6 @@
 #include "Aquarium.h"
+#include "Profiler.h"
+#include "Log.h"
 #include <cstdlib>
 #include <cmath>
 #include <algorithm>
@@ -29,6 +31,8 @@ PlayerCreature::PlayerCreature(float x, float y, int speed, std::shared_ptr<Game
 : Creature(x, y, speed, 35.0f, 1, sprite) {
     m_baseSpeed = speed;
     m_speedCap  = speed * 2;
+    m_prevX = x;
+    m_prevY = y;
 }
 
 
@@ -59,17 +63,19 @@ void PlayerCreature::activateSpeedBoost(float multiplier, int frames) {
     m_speedCap = HARD_CAP;
     m_speed    = std::min(target, HARD_CAP);
 
-    ofLogNotice() << "Speed boost active. Speed=" << m_speed
+    AQ_LOG_NOTICE() << "Speed boost active. Speed=" << m_speed
                   << "  time left=" << m_speedBoostFrames << " frames" << std::endl;
 }
 
 void PlayerCreature::update() {
+    m_prevX = m_x;
+    m_prevY = m_y;
     if (m_speedBoostFrames > 0) {
         --m_speedBoostFrames;
         if (m_speedBoostFrames <= 0) {
             m_speedBoostFrames = 0;
             m_speed = m_baseSpeed;
-            ofLogNotice() << "Speed boost ended. Speed reset to " << m_speed << std::endl;
+            AQ_LOG_NOTICE() << "Speed boost ended. Speed reset to " << m_speed << std::endl;
         }
     }
     this->reduceDamageDebounce();
@@ -78,13 +84,16 @@ void PlayerCreature::update() {
 
 
 void PlayerCreature::draw() const {
-    
-    ofLogVerbose() << "PlayerCreature at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
-    if (this->m_damage_debounce > 0) {
-        ofSetColor(ofColor::red); // Flash red if in damage debounce
-    }
+    draw(1.0f);
+}
+
+void PlayerCreature::draw(float alpha) const {
+    const float x = m_prevX + (m_x - m_prevX) * alpha;
+    const float y = m_prevY + (m_y - m_prevY) * alpha;
+    AQ_LOG_VERBOSE() << "PlayerCreature at (" << x << ", " << y << ") with speed " << m_speed << std::endl;
     if (m_sprite) {
-        m_sprite->draw(m_x, m_y);
+        // Flash red if in damage debounce
+        m_sprite->draw(x, y, m_flipped, this->m_damage_debounce > 0 ? ofColor::red : ofColor::white);
     }
     ofSetColor(ofColor::white); // Reset color
 
@@ -98,11 +107,11 @@ void PlayerCreature::loseLife(int debounce) {
     if (m_damage_debounce <= 0) {
         if (m_lives > 0) this->m_lives -= 1;
         m_damage_debounce = debounce; // Set debounce frames
-        ofLogNotice() << "Player lost a life! Lives remaining: " << m_lives << std::endl;
+        AQ_LOG_NOTICE() << "Player lost a life! Lives remaining: " << m_lives << std::endl;
     }
     // If in debounce period, do nothing
     if (m_damage_debounce > 0) {
-        ofLogVerbose() << "Player is in damage debounce period. Frames left: " << m_damage_debounce << std::endl;
+        AQ_LOG_VERBOSE() << "Player is in damage debounce period. Frames left: " << m_damage_debounce << std::endl;
     }
 }
 
@@ -114,41 +123,76 @@ void PlayerCreature::resetBounce() {
     m_hasEatenFish = false;
 }
 
+void copyFishState(FishState dst, const FishState& src) {
+    dst.x = src.x;
+    dst.y = src.y;
+    dst.dx = src.dx;
+    dst.dy = src.dy;
+    dst.speed = src.speed;
+    dst.radius = src.radius;
+    dst.tick = src.tick;
+    dst.phase = src.phase;
+    dst.targetX = src.targetX;
+    dst.targetY = src.targetY;
+    dst.id = src.id;
+}
+
+static void normalizeDir(float& dx, float& dy) {
+    float length = std::sqrt(dx * dx + dy * dy);
+    if (length != 0) {
+        dx /= length;
+        dy /= length;
+    }
+}
+
 // NPCreature Implementation
 NPCreature::NPCreature(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: Creature(x, y, speed, 30, 1, sprite) {
-    m_dx = (rand() % 3 - 1); // -1, 0, or 1
-    m_dy = (rand() % 3 - 1); // -1, 0, or 1
+: Creature(x, y, speed, 30, 1, sprite), m_id(GameRandom::nextCreatureId()) {
+    RandomStream random(m_id, 0); // tick 0 is the spawn, step() starts at tick 1
+    m_dx = (random.below(3) - 1); // -1, 0, or 1
+    m_dy = (random.below(3) - 1); // -1, 0, or 1
     normalize();
 
     m_creatureType = AquariumCreatureType::NPCreature;
 }
 
-void NPCreature::move() {
+FishState NPCreature::state() {
+    return FishState{m_x, m_y, m_dx, m_dy, m_speed, m_collisionRadius,
+                     m_tick, m_phase, m_targetX, m_targetY, m_id};
+}
+
+void NPCreature::step(FishState& s, float limitW, float limitH) {
     // Simple AI movement logic (random direction)
-    m_x += m_dx * m_speed;
-    m_y += m_dy * m_speed;
-    if(m_dx < 0 ){
-        this->m_sprite->setFlipped(true);
-    }else {
-        this->m_sprite->setFlipped(false);
-    }
-    bounce();
+    moveStraight(s, kFishStepScale, limitW, limitH);
+}
+
+// the MoveKernels vector code mirrors this, keep the float operations in the same order
+void NPCreature::moveStraight(FishState& s, float speedScale, float limitW, float limitH) {
+    const float speed = s.speed * speedScale;
+    s.x += s.dx * speed;
+    s.y += s.dy * speed;
+    bounceInBounds(s.x, s.y, s.dx, s.dy, s.radius, limitW, limitH);
+}
+
+void NPCreature::move() {
+    FishState s = state();
+    NPCreature::step(s, limitW(), limitH());
+    m_flipped = m_dx < 0;
 }
 
 void NPCreature::draw() const {
-    ofLogVerbose() << "NPCreature at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
-    ofSetColor(ofColor::white);
+    AQ_LOG_VERBOSE() << "NPCreature at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
     if (m_sprite) {
-        m_sprite->draw(m_x, m_y);
+        m_sprite->draw(m_x, m_y, m_flipped, ofColor::white);
     }
 }
 
 
 BiggerFish::BiggerFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
 : NPCreature(x, y, speed, sprite) {
-    m_dx = (rand() % 3 - 1);
-    m_dy = (rand() % 3 - 1);
+    RandomStream random(m_id, 0);
+    m_dx = (random.below(3) - 1);
+    m_dy = (random.below(3) - 1);
     normalize();
 
     setCollisionRadius(60); // Bigger fish have a larger collision radius
@@ -156,70 +200,85 @@ BiggerFish::BiggerFish(float x, float y, int speed, std::shared_ptr<GameSprite>
     m_creatureType = AquariumCreatureType::BiggerFish;
 }
 
-void BiggerFish::move() {
+void BiggerFish::step(FishState& s, float limitW, float limitH) {
     // Bigger fish might move slower or have different logic
-    m_x += m_dx * (m_speed * 0.5); // Moves at half speed
-    m_y += m_dy * (m_speed * 0.5);
-    if(m_dx < 0 ){
-        this->m_sprite->setFlipped(true);
-    }else {
-        this->m_sprite->setFlipped(false);
-    }
+    moveStraight(s, 0.5f * kFishStepScale, limitW, limitH); // Moves at half speed
+}
 
-    bounce();
+void BiggerFish::move() {
+    FishState s = state();
+    BiggerFish::step(s, limitW(), limitH());
+    m_flipped = m_dx < 0;
 }
 
 void BiggerFish::draw() const {
-    ofLogVerbose() << "BiggerFish at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
-    this->m_sprite->draw(this->m_x, this->m_y);
+    AQ_LOG_VERBOSE() << "BiggerFish at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
+    this->m_sprite->draw(this->m_x, this->m_y, this->m_flipped);
 }
 //#################### PufferFish implementation ########################################
 PufferFish::PufferFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: NPCreature(x, y, std::max(1, speed/2), sprite)
-, m_tick(0), m_cycleLen(150), m_inflateLen(45)
-, m_baseRadius(38.0f), m_inflatedRadius(54.0f) {
-    do { m_dx = (rand()%3)-1; m_dy = (rand()%3)-1; } while (m_dx==0 && m_dy==0);
+: NPCreature(x, y, std::max(1, speed/2), sprite) {
+    RandomStream random(m_id, 0);
+    do { m_dx = random.below(3)-1; m_dy = random.below(3)-1; } while (m_dx==0 && m_dy==0);
     normalize();
-    setCollisionRadius((int)m_baseRadius);
+    setCollisionRadius((int)kBaseRadius);
     m_value = 4;
     m_creatureType = AquariumCreatureType::PufferFish;
 }
-void PufferFish::move() {
-    const float MAXX = ofGetWidth()  - 20.0f;
-    const float MAXY = ofGetHeight() - 20.0f;
 
-    ++m_tick;
-    int t = m_tick % m_cycleLen;
-    bool inflated = (t < m_inflateLen);
-    float speedFactor = inflated ? 0.55f : 1.0f;
+// split in three so the MoveKernels can vectorize swim() and run the rest scalar
+void PufferFish::step(FishState& s, float limitW, float limitH) {
+    inflate(s);
+    swim(s, limitW, limitH);
+    turnAtEdge(s, limitW, limitH);
+}
+
+void PufferFish::inflate(FishState& s) {
+    ++s.tick;
+    int t = s.tick % kCycleLen;
+    bool inflated = (t < kInflateLen);
+    s.radius = inflated ? (int)kInflatedRadius : (int)kBaseRadius;
+}
 
-    setCollisionRadius(inflated ? (int)m_inflatedRadius : (int)m_baseRadius);
+void PufferFish::swim(FishState& s, float limitW, float limitH) {
+    bool inflated = (s.radius == inflatedRadius());
+    float speedFactor = inflated ? 0.55f : 1.0f;
 
-    float wobble = std::sin(0.06f * m_tick) * 0.35f;
-    m_x += m_dx * (m_speed * speedFactor) + wobble;
-    m_y += m_dy * (m_speed * speedFactor) - wobble * 0.6f;
+    float wobble = fastSin(0.06f * kFishStepScale * s.tick) * 0.35f;
+    s.x += (s.dx * (s.speed * speedFactor) + wobble) * kFishStepScale;
+    s.y += (s.dy * (s.speed * speedFactor) - wobble * 0.6f) * kFishStepScale;
 
-    if (m_sprite) m_sprite->setFlipped(m_dx < 0);
-    bounce();
+    bounceInBounds(s.x, s.y, s.dx, s.dy, s.radius, limitW, limitH);
+}
 
-    if (m_x <= 0 || m_x + getCollisionRadius()*2 >= MAXX
-     || m_y <= 0 || m_y + getCollisionRadius()*2 >= MAXY) {
-        do { m_dx = (rand()%3)-1; m_dy = (rand()%3)-1; } while (m_dx==0 && m_dy==0);
-        normalize();
+void PufferFish::turnAtEdge(FishState& s, float limitW, float limitH) {
+    const float MAXX = limitW;
+    const float MAXY = limitH;
+    if (s.x <= 0 || s.x + s.radius*2 >= MAXX
+     || s.y <= 0 || s.y + s.radius*2 >= MAXY) {
+        RandomStream random(s.id, s.tick);
+        do { s.dx = random.below(3)-1; s.dy = random.below(3)-1; } while (s.dx==0 && s.dy==0);
+        normalizeDir(s.dx, s.dy);
     }
 }
 
+void PufferFish::move() {
+    FishState s = state();
+    PufferFish::step(s, limitW(), limitH());
+    m_flipped = m_dx < 0;
+}
+
 
 
 
 
 void PufferFish::draw() const {
-    if (m_sprite) m_sprite->draw(m_x, m_y);
+    if (m_sprite) m_sprite->draw(m_x, m_y, m_flipped);
 }
 //############################ AngelFish Implementation #####################################
 Angelfish::Angelfish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: NPCreature(x, y, std::max(1, speed-1), sprite), m_phase(0.0f) {
-    m_dx = (rand()%2==0) ? 0.5f : -0.5f;
+: NPCreature(x, y, std::max(1, speed-1), sprite) {
+    m_dx = (GameRandom::below(2, m_id, 0)==0) ? 0.5f : -0.5f;
     m_dy = 1.0f;
     normalize();
     setCollisionRadius(44);
@@ -227,82 +286,225 @@ Angelfish::Angelfish(float x, float y, int speed, std::shared_ptr<GameSprite> sp
     m_creatureType = AquariumCreatureType::Angelfish;
 }
 
-void Angelfish::move() {
-    const float MAXX = ofGetWidth()  - 20.0f;
-    const float MAXY = ofGetHeight() - 20.0f;
+void Angelfish::step(FishState& s, float limitW, float limitH) {
+    const float MAXY = limitH;
 
-    m_phase += 0.05f;
-    float vy = 1.2f + std::sin(m_phase) * 0.6f;
+    // dy is the drift direction (steered by schooling, reflected at the edges), the sine a bob on top
+    s.phase += 0.05f * kFishStepScale;
+    float vy = s.dy * kDrift + fastSin(s.phase) * 0.6f;
 
-    m_x += m_dx * m_speed * 0.8f;
-    m_y += vy  * (m_speed * 0.9f);
+    s.x += s.dx * s.speed * (0.8f * kFishStepScale);
+    s.y += vy  * (s.speed * (0.9f * kFishStepScale));
 
-    if (m_sprite) m_sprite->setFlipped(m_dx < 0);
-    bounce();
+    bounceInBounds(s.x, s.y, s.dx, s.dy, s.radius, limitW, limitH); // reflects dx/dy
 
-    if (m_y <= 0 || m_y + getCollisionRadius()*2 >= MAXY) {
-        m_phase += 3.14159f;
-        m_dy = -m_dy;
-    }
-    if (m_x <= 0 || m_x + getCollisionRadius()*2 >= MAXX) {
-        m_dx = -m_dx;
+    if (s.y <= 0 || s.y + s.radius*2 >= MAXY) {
+        s.phase += 3.14159f;
     }
 }
 
+void Angelfish::move() {
+    FishState s = state();
+    Angelfish::step(s, limitW(), limitH());
+    m_flipped = m_dx < 0;
+}
+
 
 void Angelfish::draw() const {
-    if (m_sprite) m_sprite->draw(m_x, m_y);
+    if (m_sprite) m_sprite->draw(m_x, m_y, m_flipped);
 }
 
 //########################### SurgeonFish Implementation ######################################3
 Surgeonfish::Surgeonfish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: NPCreature(x, y, speed, sprite), m_tick(0) {
-    do { m_dx = (rand()%3)-1; m_dy = (rand()%3)-1; } while (m_dx==0 && m_dy==0);
+: NPCreature(x, y, speed, sprite) {
+    RandomStream random(m_id, 0);
+    do { m_dx = random.below(3)-1; m_dy = random.below(3)-1; } while (m_dx==0 && m_dy==0);
     normalize();
     setCollisionRadius(42);
     m_value = 3;
     m_creatureType = AquariumCreatureType::Surgeonfish;
 
-    m_targetX = x + ((rand()%61)-30);
-    m_targetY = y + ((rand()%61)-30);
+    m_targetX = x + (random.below(61)-30);
+    m_targetY = y + (random.below(61)-30);
 }
 
-void Surgeonfish::move() {
-    const float MAXX = ofGetWidth()  - 20.0f;
-    const float MAXY = ofGetHeight() - 20.0f;
+void Surgeonfish::step(FishState& s, float limitW, float limitH) {
+    const float MAXX = limitW;
+    const float MAXY = limitH;
 
-    ++m_tick;
-    if (m_tick % 120 == 0) {
-        m_targetX = clampf(m_x + ((rand()%201)-100), 20.0f, MAXX - 20.0f);
-        m_targetY = clampf(m_y + ((rand()%201)-100), 20.0f, MAXY - 20.0f);
+    ++s.tick;
+    RandomStream random(s.id, s.tick);
+    if (s.tick % (120 * kStepsPerFishMove) == 0) {
+        s.targetX = clampf(s.x + (random.below(201)-100), 20.0f, MAXX - 20.0f);
+        s.targetY = clampf(s.y + (random.below(201)-100), 20.0f, MAXY - 20.0f);
     }
 
-    float tx = m_targetX - (m_x + getCollisionRadius());
-    float ty = m_targetY - (m_y + getCollisionRadius());
+    float tx = s.targetX - (s.x + s.radius);
+    float ty = s.targetY - (s.y + s.radius);
     float len = std::sqrt(tx*tx + ty*ty);
     if (len > 1e-4f) { tx/=len; ty/=len; }
 
-    m_dx = 0.80f * m_dx + 0.20f * tx;
-    m_dy = 0.80f * m_dy + 0.20f * ty;
-    normalize();
+    // turns 0.20 of the way to the target every kStepsPerFishMove steps (0.8 = 0.9635^6)
+    s.dx = 0.9635f * s.dx + 0.0365f * tx;
+    s.dy = 0.9635f * s.dy + 0.0365f * ty;
+    normalizeDir(s.dx, s.dy);
 
-    m_x += m_dx * m_speed;
-    m_y += m_dy * m_speed;
+    s.x += s.dx * s.speed * kFishStepScale;
+    s.y += s.dy * s.speed * kFishStepScale;
 
-    if (m_sprite) m_sprite->setFlipped(m_dx < 0);
-    bounce();
+    bounceInBounds(s.x, s.y, s.dx, s.dy, s.radius, limitW, limitH);
 
-    if (m_x <= 0 || m_x + getCollisionRadius()*2 >= MAXX
-     || m_y <= 0 || m_y + getCollisionRadius()*2 >= MAXY) {
-        m_targetX = clampf(MAXX/2.0f + ((rand()%201)-100), 20.0f, MAXX - 20.0f);
-        m_targetY = clampf(MAXY/2.0f + ((rand()%201)-100), 20.0f, MAXY - 20.0f);
+    if (s.x <= 0 || s.x + s.radius*2 >= MAXX
+     || s.y <= 0 || s.y + s.radius*2 >= MAXY) {
+        s.targetX = clampf(MAXX/2.0f + (random.below(201)-100), 20.0f, MAXX - 20.0f);
+        s.targetY = clampf(MAXY/2.0f + (random.below(201)-100), 20.0f, MAXY - 20.0f);
     }
 }
 
+void Surgeonfish::move() {
+    FishState s = state();
+    Surgeonfish::step(s, limitW(), limitH());
+    m_flipped = m_dx < 0;
+}
+
 
 
 void Surgeonfish::draw() const {
-    if (m_sprite) m_sprite->draw(m_x, m_y);
+    if (m_sprite) m_sprite->draw(m_x, m_y, m_flipped);
+}
+
+
+// CreatureStore
+
+
+// CreatureArena
+void* CreatureArena::allocate() {
+    ++m_live;
+    if (m_free != nullptr) {
+        FreeBlock* block = m_free;
+        m_free = block->next;
+        return block;
+    }
+    if (m_bumpBlock == kBlocksPerChunk) {
+        ++m_bumpChunk;
+        m_bumpBlock = 0;
+    }
+    if (m_bumpChunk == m_chunks.size()) {
+        m_chunks.emplace_back(new unsigned char[kBlockSize * kBlocksPerChunk]);
+        ++m_heapAllocations;
+    }
+    return m_chunks[m_bumpChunk].get() + kBlockSize * m_bumpBlock++;
+}
+
+void CreatureArena::deallocate(void* block) {
+    if (--m_live == 0) {
+        // nothing is alive any more, rewind instead of keeping a free list
+        m_free = nullptr;
+        m_bumpChunk = 0;
+        m_bumpBlock = 0;
+        return;
+    }
+    FreeBlock* freed = static_cast<FreeBlock*>(block);
+    freed->next = m_free;
+    m_free = freed;
+}
+
+
+// CreatureSlotMap
+CreatureHandle CreatureSlotMap::acquire(int row) {
+    uint32_t slot;
+    if (!m_free.empty()) {
+        slot = m_free.back();
+        m_free.pop_back();
+    } else {
+        slot = (uint32_t)m_row.size();
+        m_row.push_back(-1);
+        m_generation.push_back(1);
+    }
+    m_row[slot] = row;
+    return CreatureHandle{slot, m_generation[slot]};
+}
+
+void CreatureSlotMap::release(CreatureHandle handle) {
+    if (rowOf(handle) < 0) return;
+    m_row[handle.index] = -1;
+    if (++m_generation[handle.index] == 0) m_generation[handle.index] = 1; // never hand out a null generation
+    m_free.push_back(handle.index);
+}
+
+
+// CollisionGrid
+void CollisionGrid::build(const CreatureStore& store, float width, float height) {
+    const size_t n = store.size();
+    m_maxRadius = 0.0f;
+    for (size_t i = 0; i < n; ++i) m_maxRadius = std::max(m_maxRadius, store.radius[i]);
+    m_cellSize = std::max(1.0f, 2.0f * m_maxRadius);
+    m_cols = std::max(1, (int)std::ceil(width  / m_cellSize));
+    m_rows = std::max(1, (int)std::ceil(height / m_cellSize));
+
+    // counting sort of the rows by cell
+    const size_t cells = (size_t)m_cols * m_rows;
+    m_cellStart.assign(cells + 1, 0);
+    m_cellOf.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const float r = store.radius[i];
+        const int cell = cellRow(store.y[i] + r) * m_cols + cellCol(store.x[i] + r);
+        m_cellOf[i] = cell;
+        ++m_cellStart[cell + 1];
+    }
+    for (size_t c = 0; c < cells; ++c) m_cellStart[c + 1] += m_cellStart[c];
+
+    m_fill.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+    m_row.resize(n);
+    m_cx.resize(n);
+    m_cy.resize(n);
+    m_r.resize(n);
+    m_dx.resize(n);
+    m_dy.resize(n);
+    m_species.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const int k = m_fill[m_cellOf[i]]++;
+        const float r = store.radius[i];
+        m_row[k] = (int)i;
+        m_cx[k] = store.x[i] + r;
+        m_cy[k] = store.y[i] + r;
+        m_r[k] = r;
+        m_dx[k] = store.dx[i];
+        m_dy[k] = store.dy[i];
+        m_species[k] = store.species[i];
+    }
+}
+
+void CollisionGrid::testCellPairs(int cellA, int cellB, std::vector<std::pair<int, int>>& out) const {
+    for (int a = m_cellStart[cellA]; a < m_cellStart[cellA + 1]; ++a) {
+        // within the same cell only look forward so every pair shows up once
+        const int bBegin = (cellA == cellB) ? a + 1 : m_cellStart[cellB];
+        for (int b = bBegin; b < m_cellStart[cellB + 1]; ++b) {
+            const float dx = m_cx[a] - m_cx[b];
+            const float dy = m_cy[a] - m_cy[b];
+            const float rr = m_r[a] + m_r[b];
+            if (dx*dx + dy*dy <= rr*rr) {
+                out.emplace_back(m_row[a], m_row[b]);
+            }
+        }
+    }
+}
+
+void CollisionGrid::findPairs(std::vector<std::pair<int, int>>& out) const {
+    out.clear();
+    // half of the neighbourhood per cell: itself, right, and the three below
+    for (int row = 0; row < m_rows; ++row) {
+        for (int col = 0; col < m_cols; ++col) {
+            const int cell = row * m_cols + col;
+            testCellPairs(cell, cell, out);
+            if (col + 1 < m_cols) testCellPairs(cell, cell + 1, out);
+            if (row + 1 < m_rows) {
+                if (col > 0) testCellPairs(cell, cell + m_cols - 1, out);
+                testCellPairs(cell, cell + m_cols, out);
+                if (col + 1 < m_cols) testCellPairs(cell, cell + m_cols + 1, out);
+            }
+        }
+    }
 }
 
 
@@ -317,19 +519,35 @@ AquariumSpriteManager::AquariumSpriteManager(){
     this->m_surgeonfish = std::make_shared<GameSprite>("surgeonfish.png",  96, 76);
 }
 
+AquariumSpriteManager::AquariumSpriteManager(AssetLoader& loader){
+    this->m_npc_fish = std::make_shared<GameSprite>();
+    this->m_big_fish = std::make_shared<GameSprite>();
+    this->m_speed_powerup = std::make_shared<GameSprite>();
+    this->m_puffer_fish = std::make_shared<GameSprite>();
+    this->m_angelfish = std::make_shared<GameSprite>();
+    this->m_surgeonfish = std::make_shared<GameSprite>();
+    loader.addSprite(m_npc_fish, "base-fish.png", 70, 70);
+    loader.addSprite(m_big_fish, "bigger-fish.png", 120, 120);
+    loader.addSprite(m_speed_powerup, "powerup-speed.png", 48, 48);
+    loader.addSprite(m_puffer_fish, "puffer_fish.png", 92, 92);
+    loader.addSprite(m_angelfish, "angelfish.png", 90, 90);
+    loader.addSprite(m_surgeonfish, "surgeonfish.png", 96, 76);
+}
+
+// every creature of a species shares the same sprite, so spawning never copies pixels
 std::shared_ptr<GameSprite> AquariumSpriteManager::GetSprite(AquariumCreatureType t){
     switch(t){
         case AquariumCreatureType::BiggerFish:
-            return std::make_shared<GameSprite>(*this->m_big_fish);
+            return this->m_big_fish;
             
         case AquariumCreatureType::NPCreature:
-            return std::make_shared<GameSprite>(*this->m_npc_fish);
+            return this->m_npc_fish;
         case AquariumCreatureType::PufferFish:
-            return std::make_shared<GameSprite>(*this->m_puffer_fish);
+            return this->m_puffer_fish;
         case AquariumCreatureType::Angelfish:
-            return std::make_shared<GameSprite>(*this->m_angelfish);
+            return this->m_angelfish;
         case AquariumCreatureType::Surgeonfish:
-            return std::make_shared<GameSprite>(*this->m_surgeonfish);
+            return this->m_surgeonfish;
         default:
             return nullptr;
     }
@@ -340,14 +558,45 @@ std::shared_ptr<GameSprite> AquariumSpriteManager::GetSprite(AquariumCreatureTyp
 Aquarium::Aquarium(int width, int height, std::shared_ptr<AquariumSpriteManager> spriteManager)
     : m_width(width), m_height(height) {
         m_sprite_manager =  spriteManager;
+        for (ofVboMesh& batch : m_batches) {
+            batch.setMode(OF_PRIMITIVE_TRIANGLES);
+            batch.setUsage(GL_STREAM_DRAW);
+        }
 
     }
 
 
 
-void Aquarium::addCreature(std::shared_ptr<Creature> creature) {
+CreatureHandle Aquarium::addCreature(std::shared_ptr<NPCreature> creature) {
+    if (!creature) return CreatureHandle{};
     creature->setBounds(m_width - 20, m_height - 20);
-    m_creatures.push_back(creature);
+    m_creatures.emplace_back();
+    const size_t row = m_store.insert(creature->GetType(), [this](size_t from, size_t to) { relocateRow(from, to); });
+    creature->m_handle = m_slots.acquire((int)row);
+    m_store.slot[row] = creature->m_handle.index;
+    m_store.value[row] = creature->getValue();
+    copyFishState(m_store.row(row), creature->state());
+    m_store.prevX[row] = m_store.x[row];
+    m_store.prevY[row] = m_store.y[row];
+    m_creatures[row] = std::move(creature);
+    m_gridDirty = true;
+    raise(GameEvent(GameEventType::CREATURE_ADDED, m_creatures[row]->m_handle, CreatureHandle{}));
+    return m_creatures[row]->m_handle;
+}
+
+// the store moved row `from` to `to`, bring its view, slot and pending mark along
+void Aquarium::relocateRow(size_t from, size_t to) {
+    m_creatures[to] = std::move(m_creatures[from]);
+    m_slots.setRow(m_store.slot[to], (int)to);
+    for (int& pending : m_pendingViews) {
+        if (pending == (int)from) pending = (int)to;
+    }
+}
+
+void Aquarium::setUpdateThreads(int threads) {
+    if (threads == getUpdateThreads()) return;
+    m_workers.reset();
+    if (threads > 1) m_workers = std::make_unique<WorkerPool>(threads);
 }
 
 void Aquarium::addAquariumLevel(std::shared_ptr<AquariumLevel> level){
@@ -355,24 +604,141 @@ void Aquarium::addAquariumLevel(std::shared_ptr<AquariumLevel> level){
     this->m_aquariumlevels.push_back(level);
 }
 
+template <class Species>
+static void stepSpecies(CreatureStore& store, size_t begin, size_t end, float limitW, float limitH) {
+    for (size_t i = begin; i < end; ++i) {
+        store.prevX[i] = store.x[i];
+        store.prevY[i] = store.y[i];
+        FishState s = store.row(i);
+        Species::step(s, limitW, limitH);
+    }
+}
+
+// Boids: turn each fish in [begin, end) towards the heading and the centre of the fish of
+// its species within kSchoolRadius, and away from the ones closer than kSeparationRadius.
+// Neighbours are read from the grid snapshot, so a row only writes its own heading and
+// the result does not depend on the order rows are stepped in.
+static void steerSchool(CreatureStore& s, const CollisionGrid& grid, AquariumCreatureType species, size_t begin, size_t end) {
+    constexpr float kSeparationRadius = 45.0f;
+    constexpr float kAlignWeight = 0.05f * kFishStepScale; // per step, tuned per fish move
+    constexpr float kCohesionWeight = 0.02f * kFishStepScale;
+    constexpr float kSeparationWeight = 0.08f * kFishStepScale;
+    for (size_t i = begin; i < end; ++i) {
+        const float cx = s.x[i] + s.radius[i];
+        const float cy = s.y[i] + s.radius[i];
+        float alignX = 0.0f, alignY = 0.0f;
+        float centreX = 0.0f, centreY = 0.0f;
+        float awayX = 0.0f, awayY = 0.0f;
+        int count = 0;
+        grid.forEachNeighbour(species, cx, cy, Aquarium::kSchoolRadius, [&](int row, float ox, float oy, float odx, float ody) {
+            if (row == (int)i) return;
+            alignX += odx;
+            alignY += ody;
+            centreX += ox;
+            centreY += oy;
+            ++count;
+            const float ax = cx - ox, ay = cy - oy;
+            const float d2 = ax*ax + ay*ay;
+            if (d2 > 0.0f && d2 < kSeparationRadius * kSeparationRadius) {
+                awayX += ax / d2; // pushes harder the closer they are
+                awayY += ay / d2;
+            }
+        });
+        if (count == 0) continue;
+
+        const float inv = 1.0f / count;
+        float dx = s.dx[i], dy = s.dy[i];
+        dx += kAlignWeight * (alignX * inv - dx)
+            + kCohesionWeight * (centreX * inv - cx) / Aquarium::kSchoolRadius
+            + kSeparationWeight * awayX * kSeparationRadius;
+        dy += kAlignWeight * (alignY * inv - dy)
+            + kCohesionWeight * (centreY * inv - cy) / Aquarium::kSchoolRadius
+            + kSeparationWeight * awayY * kSeparationRadius;
+        const float length = std::sqrt(dx*dx + dy*dy);
+        if (length > 1e-6f) {
+            s.dx[i] = dx / length;
+            s.dy[i] = dy / length;
+        }
+    }
+}
+
 void Aquarium::update() {
-    // Keep aquarium bounds synced to the current window size
-    m_width  = ofGetWidth();
-    m_height = ofGetHeight();
+    PROFILE_ZONE("Aquarium::update");
+    // bounds come from setBounds() (ofApp::windowResized or the headless runner)
+    this->flushCreatureViews();
+    ++m_tick;
 
-    // Update bounds for every creature and move them
-    for (auto& creature : m_creatures) {
-        creature->setBounds(m_width - 20, m_height - 20);  // optional margin
-        creature->move();  // move() already calls bounce()
+    // Move every fish straight out of the store, 20px margin like the creature bounds.
+    // Rows only touch their own columns (schooling reads the others from the grid), so
+    // big tanks are split across the worker pool.
+    const float limitW = m_width - 20.0f;
+    const float limitH = m_height - 20.0f;
+    const CollisionGrid* school = m_schooling ? &getCollisionGrid() : nullptr;
+    auto stepRows = [this, school, limitW, limitH](size_t begin, size_t end) {
+        // one loop per species range inside [begin, end), vectorized where MoveKernels covers it
+        for (int t = 0; t < kCreatureTypeCount; ++t) {
+            const size_t lo = std::max(begin, m_store.speciesBegin[t]);
+            const size_t hi = std::min(end, m_store.speciesEnd(t));
+            if (lo >= hi) continue;
+            const AquariumCreatureType type = static_cast<AquariumCreatureType>(t);
+            if (school && (type == AquariumCreatureType::NPCreature || type == AquariumCreatureType::Angelfish)) {
+                steerSchool(m_store, *school, type, lo, hi);
+            }
+            switch (type) {
+                case AquariumCreatureType::NPCreature:  m_kernels->straight(m_store, lo, hi, kFishStepScale, limitW, limitH); break;
+                case AquariumCreatureType::BiggerFish:  m_kernels->straight(m_store, lo, hi, 0.5f * kFishStepScale, limitW, limitH); break;
+                case AquariumCreatureType::PufferFish:  m_kernels->puffer(m_store, lo, hi, limitW, limitH); break;
+                case AquariumCreatureType::Angelfish:   m_kernels->angelfish(m_store, lo, hi, limitW, limitH); break;
+                case AquariumCreatureType::Surgeonfish: stepSpecies<Surgeonfish>(m_store, lo, hi, limitW, limitH); break;
+            }
+        }
+    };
+    if (m_workers && m_store.size() >= kParallelUpdateMinRows) {
+        m_workers->parallelFor(m_store.size(), kParallelUpdateChunk, stepRows);
+    } else {
+        stepRows(0, m_store.size());
     }
     maybeSpawnPowerUp();
     this->Repopulate();
+
+    m_grid.build(m_store, (float)m_width, (float)m_height);
+    m_gridDirty = false;
+}
+
+const CollisionGrid& Aquarium::getCollisionGrid() {
+    if (m_gridDirty) {
+        m_grid.build(m_store, (float)m_width, (float)m_height);
+        m_gridDirty = false;
+    }
+    return m_grid;
 }
 
 
-void Aquarium::draw() const {
-    for (const auto& creature : m_creatures) {
-        creature->draw();
+void Aquarium::draw(float alpha) const {
+    PROFILE_ZONE("Aquarium::draw");
+    std::shared_ptr<GameSprite> sprites[kCreatureTypeCount];
+    for (int t = 0; t < kCreatureTypeCount; ++t) {
+        sprites[t] = m_sprite_manager->GetSprite(static_cast<AquariumCreatureType>(t));
+        m_batches[t].clear(); // keeps the vertex capacity from last frame
+    }
+
+    // every fish becomes a quad in its species' batch
+    for (size_t i = 0; i < m_store.size(); ++i) {
+        const int t = static_cast<int>(m_store.species[i]);
+        if (!sprites[t]) continue;
+        const NPCreature* view = m_creatures[i].get();
+        if (view && view->m_viewPending) { // the view may have been changed since it was handed out
+            sprites[t]->addToBatch(m_batches[t], view->m_x, view->m_y, view->m_dx < 0);
+            continue;
+        }
+        const float x = m_store.prevX[i] + (m_store.x[i] - m_store.prevX[i]) * alpha;
+        const float y = m_store.prevY[i] + (m_store.y[i] - m_store.prevY[i]) * alpha;
+        sprites[t]->addToBatch(m_batches[t], x, y, m_store.dx[i] < 0);
+    }
+
+    ofSetColor(ofColor::white);
+    for (int t = 0; t < kCreatureTypeCount; ++t) {
+        if (sprites[t]) sprites[t]->drawBatch(m_batches[t]);
     }
     for (const auto& p : m_powerups) {
         if (p.sprite) p.sprite->draw(p.x - p.radius, p.y - p.radius);
@@ -380,21 +746,22 @@ void Aquarium::draw() const {
 }
 
 void Aquarium::maybeSpawnPowerUp() {
-    if ((int)m_powerups.size() >= 2) return;
+    if ((int)m_powerups.size() >= kMaxPowerUps) return;
 
     ++m_powerupSpawnTimer;
-    if (m_powerupSpawnTimer < 90) return;
+    if (m_powerupSpawnTimer < 90 * kStepsPerFishMove) return;
     m_powerupSpawnTimer = 0;
 
-    if ((rand() % 10) >= 8) return;
+    RandomStream random(GameRandom::kPowerUpKey, m_tick);
+    if (random.below(10) >= 8) return;
 
     PowerUpItem p;
     p.radius = 24.f;
     p.sprite = m_sprite_manager->GetPowerUpSprite(PowerUpType::SpeedBoost);
 
     int margin = 30;
-    p.x = (float)(margin + rand() % std::max(1, getWidth()  - 2*margin));
-    p.y = (float)(margin + rand() % std::max(1, getHeight() - 2*margin));
+    p.x = (float)(margin + random.below(std::max(1, getWidth()  - 2*margin)));
+    p.y = (float)(margin + random.below(std::max(1, getHeight() - 2*margin)));
 
     m_powerups.push_back(std::move(p));
 }
@@ -404,52 +771,133 @@ void Aquarium::removePowerUpAt(size_t idx) {
 }
 
 void Aquarium::removeCreature(std::shared_ptr<Creature> creature) {
-    auto it = std::find(m_creatures.begin(), m_creatures.end(), creature);
-    if (it != m_creatures.end()) {
-        ofLogVerbose() << "removing creature " << endl;
-        int selectLvl = this->currentLevel % this->m_aquariumlevels.size();
-        auto npcCreature = std::static_pointer_cast<NPCreature>(creature);
-        this->m_aquariumlevels.at(selectLvl)->ConsumePopulation(npcCreature->GetType(), npcCreature->getValue());
-        m_creatures.erase(it);
+    NPCreature* npc = dynamic_cast<NPCreature*>(creature.get());
+    if (npc == nullptr) {
+        AQ_LOG_WARNING() << "removeCreature: not an aquarium creature" << endl;
+        return;
+    }
+    const int row = m_slots.rowOf(npc->m_handle);
+    if (row >= 0 && m_creatures[row].get() == npc) {
+        this->removeCreature(npc->m_handle);
     }
 }
 
+bool Aquarium::removeCreature(CreatureHandle handle) {
+    const int row = m_slots.rowOf(handle);
+    if (row < 0) return false;
+
+    AQ_LOG_VERBOSE() << "removing creature " << endl;
+    int selectLvl = this->currentLevel % this->m_aquariumlevels.size();
+    this->m_aquariumlevels.at(selectLvl)->ConsumePopulation(m_store.species[row], m_store.value[row]);
+
+    if (NPCreature* removed = m_creatures[row].get()) {
+        if (removed->m_viewPending) {
+            removed->m_viewPending = false;
+            m_pendingViews.erase(std::find(m_pendingViews.begin(), m_pendingViews.end(), row));
+        }
+        removed->m_handle = CreatureHandle{};
+    }
+    m_slots.release(handle);
+
+    // rows that fill the gap take their views along, the removed view is overwritten or popped
+    m_store.remove(row, [this](size_t from, size_t to) { relocateRow(from, to); });
+    m_creatures.pop_back();
+    m_gridDirty = true;
+    raise(GameEvent(GameEventType::CREATURE_REMOVED, handle, CreatureHandle{}));
+    return true;
+}
+
 void Aquarium::clearCreatures() {
+    for (int idx : m_pendingViews) m_creatures[idx]->m_viewPending = false;
+    m_pendingViews.clear();
+    for (size_t row = 0; row < m_store.size(); ++row) {
+        m_slots.release(getCreatureHandle((int)row));
+        if (m_creatures[row]) m_creatures[row]->m_handle = CreatureHandle{};
+    }
+    m_store.clear();
     m_creatures.clear();
+    m_gridDirty = true;
 }
 
 std::shared_ptr<Creature> Aquarium::getCreatureAt(int index) {
-    if (index < 0 || size_t(index) >= m_creatures.size()) {
+    if (index < 0 || size_t(index) >= m_store.size()) {
         return nullptr;
     }
-    return m_creatures[index];
+    std::shared_ptr<NPCreature>& view = viewAt(index);
+    if (!view->m_viewPending) {
+        copyFishState(view->state(), m_store.row(index));
+        view->setBounds(m_width - 20, m_height - 20);
+        view->m_flipped = view->m_dx < 0;
+        view->m_viewPending = true;
+        m_pendingViews.push_back(index);
+    }
+    return view;
+}
+
+// Rows loaded from a snapshot have no view yet. The new one gets its state from the row
+// when it is handed out; it must not use up a creature id, the row already has one.
+std::shared_ptr<NPCreature>& Aquarium::viewAt(size_t row) {
+    std::shared_ptr<NPCreature>& view = m_creatures[row];
+    if (view) return view;
+    const AquariumCreatureType type = m_store.species[row];
+    const uint32_t lastId = GameRandom::lastCreatureId();
+    switch (type) {
+        case AquariumCreatureType::BiggerFish:  view = makeCreature<BiggerFish>(0, 0, 0, type); break;
+        case AquariumCreatureType::PufferFish:  view = makeCreature<PufferFish>(0, 0, 0, type); break;
+        case AquariumCreatureType::Angelfish:   view = makeCreature<Angelfish>(0, 0, 0, type); break;
+        case AquariumCreatureType::Surgeonfish: view = makeCreature<Surgeonfish>(0, 0, 0, type); break;
+        default:                                view = makeCreature<NPCreature>(0, 0, 0, type); break;
+    }
+    GameRandom::setLastCreatureId(lastId);
+    view->m_handle = getCreatureHandle((int)row);
+    return view;
+}
+
+const CreatureStore& Aquarium::getSyncedStore(CreatureStore& scratch) const {
+    if (m_pendingViews.empty()) return m_store;
+    scratch = m_store;
+    for (int idx : m_pendingViews) copyFishState(scratch.row(idx), m_creatures[idx]->state());
+    return scratch;
+}
+
+// write back whatever callers did to the views they got from getCreatureAt
+void Aquarium::flushCreatureViews() {
+    for (int idx : m_pendingViews) {
+        std::shared_ptr<NPCreature>& view = m_creatures[idx];
+        copyFishState(m_store.row(idx), view->state());
+        view->m_viewPending = false;
+    }
+    if (!m_pendingViews.empty()) m_gridDirty = true; // a view may have moved its fish
+    m_pendingViews.clear();
 }
 
 
 
 void Aquarium::SpawnCreature(AquariumCreatureType type) {
-    int x = rand() % this->getWidth();
-    int y = rand() % this->getHeight();
-    int speed = 1 + rand() % 25; // Speed between 1 and 25
+    uint32_t r[3];
+    GameRandom::fill(GameRandom::kSpawnKey, 3 * m_spawnCount++, r, 3);
+    int x = (int)(r[0] % (uint32_t)this->getWidth());
+    int y = (int)(r[1] % (uint32_t)this->getHeight());
+    int speed = 1 + (int)(r[2] % 25); // Speed between 1 and 25
 
     switch (type) {
         case AquariumCreatureType::NPCreature:
-            this->addCreature(std::make_shared<NPCreature>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::NPCreature)));
+            this->addCreature(this->makeCreature<NPCreature>(x, y, speed, type));
             break;
         case AquariumCreatureType::BiggerFish:
-            this->addCreature(std::make_shared<BiggerFish>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::BiggerFish)));
+            this->addCreature(this->makeCreature<BiggerFish>(x, y, speed, type));
             break;
         case AquariumCreatureType::PufferFish:
-            this->addCreature(std::make_shared<PufferFish>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::PufferFish)));
+            this->addCreature(this->makeCreature<PufferFish>(x, y, speed, type));
             break;
         case AquariumCreatureType::Angelfish:
-            this->addCreature(std::make_shared<Angelfish>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::Angelfish)));
+            this->addCreature(this->makeCreature<Angelfish>(x, y, speed, type));
             break;
         case AquariumCreatureType::Surgeonfish:
-            this->addCreature(std::make_shared<Surgeonfish>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::Surgeonfish)));
+            this->addCreature(this->makeCreature<Surgeonfish>(x, y, speed, type));
             break;
         default:
-            ofLogError() << "Unknown creature type to spawn!";
+            AQ_LOG_ERROR() << "Unknown creature type to spawn!";
             break;
     }
 
@@ -461,10 +909,11 @@ void Aquarium::SpawnCreature(AquariumCreatureType type) {
 // once lvl criteria met, we move to new lvl through inner signal asking for new lvl
 // which will mean incrementing the buffer and pointing to a new lvl index
 void Aquarium::Repopulate() {
-    ofLogVerbose("entering phase repopulation");
+    PROFILE_ZONE("Aquarium::Repopulate");
+    AQ_LOG_VERBOSE() << "entering phase repopulation";
     // lets make the levels circular
     int selectedLevelIdx = this->currentLevel % this->m_aquariumlevels.size();
-    ofLogVerbose() << "the current index: " << selectedLevelIdx << endl;
+    AQ_LOG_VERBOSE() << "the current index: " << selectedLevelIdx << endl;
     std::shared_ptr<AquariumLevel> level = this->m_aquariumlevels.at(selectedLevelIdx);
 
 
@@ -472,113 +921,202 @@ void Aquarium::Repopulate() {
         level->levelReset();
         this->currentLevel += 1;
         selectedLevelIdx = this->currentLevel % this->m_aquariumlevels.size();
-        ofLogNotice()<<"new level reached : " << selectedLevelIdx << std::endl;
+        raise(GameEvent(GameEventType::NEW_LEVEL, CreatureHandle{}, CreatureHandle{}, selectedLevelIdx));
         level = this->m_aquariumlevels.at(selectedLevelIdx);
         this->clearCreatures();
+        std::fill(std::begin(m_pendingSpawns), std::end(m_pendingSpawns), 0); // the old level's
+        m_pendingSpawnTotal = 0;
     }
 
     
     // now lets find how many to respawn if needed 
-    std::vector<AquariumCreatureType> toRespawn = level->Repopulate();
-    ofLogVerbose() << "amount to repopulate : " << toRespawn.size() << endl;
-    if(toRespawn.size() <= 0 ){return;} // there is nothing for me to do here
-    for(AquariumCreatureType newCreatureType : toRespawn){
-        this->SpawnCreature(newCreatureType);
+    int missing[kCreatureTypeCount];
+    int toRespawn = level->Repopulate(missing);
+    if(toRespawn > 0){
+        AQ_LOG_VERBOSE() << "amount to repopulate : " << toRespawn << endl;
+        for(int t = 0; t < kCreatureTypeCount; ++t){
+            m_pendingSpawns[t] += missing[t];
+        }
+        m_pendingSpawnTotal += toRespawn;
+    }
+    if(m_pendingSpawnTotal == 0){return;} // there is nothing for me to do here
+
+    int budget = (m_spawnBudget > 0) ? std::min(m_spawnBudget, m_pendingSpawnTotal) : m_pendingSpawnTotal;
+    m_pendingSpawnTotal -= budget;
+    for(int t = 0; t < kCreatureTypeCount && budget > 0; ++t){
+        const int n = std::min(budget, m_pendingSpawns[t]);
+        for(int i = 0; i < n; ++i){
+            this->SpawnCreature(static_cast<AquariumCreatureType>(t));
+        }
+        m_pendingSpawns[t] -= n;
+        budget -= n;
     }
 }
 
 // Aquarium collision detection
-std::shared_ptr<GameEvent> DetectAquariumCollisions(std::shared_ptr<Aquarium> aquarium, std::shared_ptr<PlayerCreature> player) {
-    if (!aquarium || !player) return nullptr;
-    
-    for (int i = 0; i < aquarium->getCreatureCount(); ++i) {
-        std::shared_ptr<Creature> npc = aquarium->getCreatureAt(i);
-        if (npc && checkCollision(player, npc)) {
-            return std::make_shared<GameEvent>(GameEventType::COLLISION, player, npc);
-        }
-    }
-    return nullptr;
-    
+int DetectAquariumCollisions(const std::shared_ptr<Aquarium>& aquarium, const std::shared_ptr<PlayerCreature>& player, GameEventQueue& events) {
+    PROFILE_ZONE("DetectAquariumCollisions");
+    if (!aquarium || !player) return 0;
+    int found = 0;
+
+    const float r = player->getCollisionRadius();
+    aquarium->getCollisionGrid().forEachOverlap(player->getX() + r, player->getY() + r, r, [&](int row) {
+        events.push(GameEvent(GameEventType::COLLISION, CreatureHandle{}, aquarium->getCreatureHandle(row)));
+        ++found;
+    });
+    return found;
 };
 
 //  Imlementation of the AquariumScene
+AquariumGameScene::AquariumGameScene(std::shared_ptr<PlayerCreature> player, std::shared_ptr<Aquarium> aquarium, string name)
+: m_player(std::move(player)) , m_aquarium(std::move(aquarium)), m_name(name) {
+    m_events.subscribe<&AquariumGameScene::OnCollision>(GameEventType::COLLISION, this);
+    m_events.subscribe<&AquariumGameScene::OnNewLevel>(GameEventType::NEW_LEVEL, this);
+    m_aquarium->setEventQueue(&m_events);
+}
+
+AquariumGameScene::~AquariumGameScene() {
+    m_aquarium->setEventQueue(nullptr); // the aquarium may outlive the scene
+}
 
 // Aquarium.cpp
 void AquariumGameScene::Update() {
-    std::shared_ptr<GameEvent> event;
+    // clamp so a long stall (window drag, breakpoint) is not replayed as a burst of steps
+    m_accumulator += std::min((double)ofGetLastFrameTime(), 0.25);
+    int steps = 0;
+    while (m_accumulator >= kStepSeconds) {
+        if (steps == m_maxCatchUpSteps) {
+            m_accumulator = std::fmod(m_accumulator, kStepSeconds); // fall behind instead of spiralling
+            break;
+        }
+        if (m_lastEvent.isGameOver()) break;
+        Step();
+        m_accumulator -= kStepSeconds;
+        ++steps;
+    }
+}
+
+void AquariumGameScene::Step() {
+    ++m_tick;
     m_player->update();
 
-    if (updateControl.tick()) {
-        event = DetectAquariumCollisions(m_aquarium, m_player);
-
-        if (event && event->isCollisionEvent()) {
-            if (event->creatureB) {
-                auto a = m_player;
-                auto b = event->creatureB;
-
-                if (a->getPower() < b->getValue()) {
-                    float ar = a->getCollisionRadius();
-                    float br = b->getCollisionRadius();
-                    float ax = a->getX() + ar, ay = a->getY() + ar;
-                    float bx = b->getX() + br, by = b->getY() + br;
-                    float nx = ax - bx, ny = ay - by;
-                    float dist2 = nx*nx + ny*ny;
-                    float sumr  = ar + br;
-
-                    if (dist2 < sumr*sumr) {
-                        float dist = std::sqrt(std::max(1e-6f, dist2));
-                        nx /= dist; ny /= dist;
-                        float overlap = sumr - dist;
-                        a->translate( nx * overlap * 0.60f,  ny * overlap * 0.60f);
-                        b->translate(-nx * overlap * 0.40f, -ny * overlap * 0.40f);
-                        a->reflect( nx, ny);
-                        b->reflect(-nx,-ny);
-                    }
-
-                    a->loseLife(3*60);
-
-                    if (a->getLives() <= 0) {
-                        m_lastEvent = std::make_shared<GameEvent>(GameEventType::GAME_OVER, a, nullptr);
-                        return;
-                    }
-                } else {
-                    // STRONG ENOUGH → eat without any bounce/reflect
-                    m_aquarium->removeCreature(b);
-                    m_player->addToScore(1, b->getValue());
-                    m_player->eatFish();
-
-                    if (m_player->getScore() % 25 == 0) {
-                        m_player->increasePower(1);
-                    }
-                }
-            }
+    DetectAquariumCollisions(m_aquarium, m_player, m_events);
+    m_events.dispatch(); // every contact this tick, see OnCollision
+    if (m_lastEvent.isGameOver()) return;
+
+    // packed the same way as the grid so the pickup test is one batch call
+    const std::vector<PowerUpItem>& powerUps = m_aquarium->getPowerUps();
+    float px[Aquarium::kMaxPowerUps], py[Aquarium::kMaxPowerUps], pr[Aquarium::kMaxPowerUps];
+    const size_t count = std::min(powerUps.size(), (size_t)Aquarium::kMaxPowerUps);
+    for (size_t i = 0; i < count; ++i) {
+        px[i] = powerUps[i].x;
+        py[i] = powerUps[i].y;
+        pr[i] = powerUps[i].radius;
+    }
+    const float ar = m_player->getCollisionRadius();
+    const uint64_t hits = m_aquarium->getMoveKernels().overlap(m_player->getX() + ar, m_player->getY() + ar, ar, px, py, pr, count);
+    for (size_t i = count; i-- > 0;) { // back to front so the lower indices stay valid
+        if ((hits >> i) & 1) {
+            m_player->activateSpeedBoost(2.0f, 10 * 60);
+            m_aquarium->removePowerUpAt(i);
         }
+    }
 
-        auto& powerUps = const_cast<std::vector<PowerUpItem>&>(m_aquarium->getPowerUps());
-        for (size_t i = 0; i < powerUps.size();) {
-            const PowerUpItem& p = powerUps[i];
-            float ar = m_player->getCollisionRadius();
-            float dx = (m_player->getX() + ar) - p.x;
-            float dy = (m_player->getY() + ar) - p.y;
-            float rr = ar + p.radius;
-            if (dx*dx + dy*dy <= rr*rr) {
-                m_player->activateSpeedBoost(2.0f, 10 * 60);
-                m_aquarium->removePowerUpAt(i);
-                continue;
-            }
-            ++i;
+    m_aquarium->update();
+    m_events.dispatch(); // what update() raised
+}
+
+void AquariumGameScene::OnCollision(const GameEvent& event) {
+    if (m_lastEvent.isGameOver()) return; // an earlier contact this tick was the last life
+    auto a = m_player;
+    auto b = m_aquarium->getCreature(event.creatureB);
+    if (!b) return; // already eaten this tick
+
+    if (a->getPower() < b->getValue()) {
+        float ar = a->getCollisionRadius();
+        float br = b->getCollisionRadius();
+        float ax = a->getX() + ar, ay = a->getY() + ar;
+        float bx = b->getX() + br, by = b->getY() + br;
+        float nx = ax - bx, ny = ay - by;
+        float dist2 = nx*nx + ny*ny;
+        float sumr  = ar + br;
+
+        if (dist2 < sumr*sumr) {
+            float dist = std::sqrt(std::max(1e-6f, dist2));
+            nx /= dist; ny /= dist;
+            float overlap = sumr - dist;
+            a->translate( nx * overlap * 0.60f,  ny * overlap * 0.60f);
+            b->translate(-nx * overlap * 0.40f, -ny * overlap * 0.40f);
+            a->reflect( nx, ny);
+            b->reflect(-nx,-ny);
         }
 
-        m_aquarium->update();
+        a->loseLife(3*60); // debounced, so several contacts in one tick cost one life
+
+        if (a->getLives() <= 0) {
+            m_lastEvent = GameEvent(GameEventType::GAME_OVER, CreatureHandle{}, CreatureHandle{});
+            m_events.push(m_lastEvent);
+        }
+    } else {
+        // STRONG ENOUGH → eat without any bounce/reflect
+        m_aquarium->removeCreature(event.creatureB);
+        m_player->addToScore(1, b->getValue());
+        m_player->eatFish();
+
+        if (m_player->getScore() % 25 == 0) {
+            m_player->increasePower(1);
+        }
     }
 }
 
+void AquariumGameScene::OnNewLevel(const GameEvent& event) {
+    AQ_LOG_NOTICE() << "new level reached : " << event.value << std::endl;
+}
+
 
 
 
+void AquariumGameScene::HandleKeyPressed(int key) {
+    switch(key){
+        case OF_KEY_UP:
+            m_player->setDirection(m_player->isXDirectionActive()?m_player->getDx():0, -1);
+            break;
+        case OF_KEY_DOWN:
+            m_player->setDirection(m_player->isXDirectionActive()?m_player->getDx():0, 1);
+            break;
+        case OF_KEY_LEFT:
+            m_player->setDirection(-1, m_player->isYDirectionActive()?m_player->getDy():0);
+            m_player->setFlipped(true);
+            break;
+        case OF_KEY_RIGHT:
+            m_player->setDirection(1, m_player->isYDirectionActive()?m_player->getDy():0);
+            m_player->setFlipped(false);
+            break;
+        default:
+            break;
+    }
+    m_player->move();
+}
+
+void AquariumGameScene::HandleKeyReleased(int key) {
+    if( key == OF_KEY_UP || key == OF_KEY_DOWN){
+        m_player->setDirection(m_player->isXDirectionActive()?m_player->getDx():0, 0);
+        m_player->move();
+        return;
+    }
+    if(key == OF_KEY_LEFT || key == OF_KEY_RIGHT){
+        m_player->setDirection(0, m_player->isYDirectionActive()?m_player->getDy():0);
+        m_player->move();
+        return;
+    }
+}
+
 void AquariumGameScene::Draw() {
-    this->m_player->draw();
-    this->m_aquarium->draw();
+    // how far we are between the last step and the next one; the player and the fish both
+    // move every step, so they are drawn at most one step behind where collisions test them
+    const float stepAlpha = (float)std::min(1.0, m_accumulator / kStepSeconds);
+    this->m_player->draw(stepAlpha);
+    this->m_aquarium->draw(stepAlpha);
     this->paintAquariumHUD();
 
 }
@@ -599,46 +1137,95 @@ void AquariumGameScene::paintAquariumHUD(){
         int secs = (frames + 59) / 60;
         ofDrawBitmapString("Speed Boost: " + std::to_string(secs) + "s", panelWidth, 70);
     }
+    if (m_showProfiler) {
+        // ms per frame over the last second, slowest first, indented by nesting
+        float y = 20;
+        char line[128];
+        for (const Profiler::ZoneSummary& zone : Profiler::summarize(60)) {
+            snprintf(line, sizeof(line), "%*s%-28s %6.2f avg %6.2f max %4.1fx",
+                     zone.depth * 2, "", zone.name, zone.avgMillis, zone.maxMillis, zone.calls);
+            ofDrawBitmapString(line, 10, y);
+            y += 12;
+        }
+    }
     ofSetColor(ofColor::white); // Reset color to white for other drawings
 }
 
+AquariumLevel::AquariumLevel(int levelNumber, int targetScore)
+: GameLevel(levelNumber), m_level_score(0), m_targetScore(targetScore){
+    for(int t = 0; t < kCreatureTypeCount; ++t){
+        this->m_levelPopulation[t].creatureType = static_cast<AquariumCreatureType>(t);
+    }
+}
+
+void AquariumLevel::setPopulation(AquariumCreatureType creatureType, int population){
+    this->m_levelPopulation[(int)creatureType].population = std::max(0, population);
+}
+
 void AquariumLevel::populationReset(){
-    for(auto node: this->m_levelPopulation){
-        node->currentPopulation = 0; // need to reset the population to ensure they are made a new in the next level
+    for(AquariumLevelPopulationNode& node: this->m_levelPopulation){
+        node.currentPopulation = 0; // need to reset the population to ensure they are made a new in the next level
     }
 }
 
 void AquariumLevel::ConsumePopulation(AquariumCreatureType creatureType, int power){
-    for(std::shared_ptr<AquariumLevelPopulationNode> node: this->m_levelPopulation){
-        ofLogVerbose() << "consuming from this level creatures" << endl;
-        if(node->creatureType == creatureType){
-            ofLogVerbose() << "-cosuming from type: " << AquariumCreatureTypeToString(node->creatureType) <<" , currPop: " << node->currentPopulation << endl;
-            if(node->currentPopulation == 0){
-                return;
-            } 
-            node->currentPopulation -= 1;
-            ofLogVerbose() << "+cosuming from type: " << AquariumCreatureTypeToString(node->creatureType) <<" , currPop: " << node->currentPopulation << endl;
-            this->m_level_score += power;
-            return;
-        }
+    AquariumLevelPopulationNode& node = this->m_levelPopulation[(int)creatureType];
+    AQ_LOG_VERBOSE() << "-cosuming from type: " << AquariumCreatureTypeToString(node.creatureType) <<" , currPop: " << node.currentPopulation << endl;
+    if(node.currentPopulation == 0){
+        return;
     }
+    node.currentPopulation -= 1;
+    this->m_level_score += power;
 }
 
 bool AquariumLevel::isCompleted(){
     return this->m_level_score >= this->m_targetScore;
 }
 
-std::vector<AquariumCreatureType> AquariumLevel::Repopulate() {
-    std::vector<AquariumCreatureType> toRepopulate;
-    for (const auto& node : m_levelPopulation) {
-        int delta = node->population - node->currentPopulation;
-        if (delta > 0) {
-            for (int i = 0; i < delta; ++i) {
-                toRepopulate.push_back(node->creatureType);
-            }
+int AquariumLevel::Repopulate(int missing[kCreatureTypeCount]) {
+    int total = 0;
+    for (int t = 0; t < kCreatureTypeCount; ++t) {
+        AquariumLevelPopulationNode& node = m_levelPopulation[t];
+        missing[t] = std::max(0, node.population - node.currentPopulation);
+        node.currentPopulation += missing[t];
+        total += missing[t];
+    }
+    return total;
+}
 
-            node->currentPopulation += delta;
+AquariumSettings LoadAquariumSettings(const std::string& path) {
+    AquariumSettings settings;
+    ofXml xml;
+    ofXml group;
+    if (xml.load(path)) {
+        group = xml.getChild("group");
+    } else {
+        AQ_LOG_NOTICE() << "no " << path << ", using the built-in levels" << std::endl;
+    }
+    if (group) {
+        ofXml speed = group.getChild("player_speed");
+        if (speed) settings.playerSpeed = speed.getIntValue();
+
+        for (const ofXml& levelXml : group.getChild("levels").getChildren("level")) {
+            auto level = std::make_shared<AquariumLevel>((int)settings.levels.size(), levelXml.getAttribute("target").getIntValue());
+            for (const ofXml& fish : levelXml.getChildren("fish")) {
+                const std::string type = fish.getAttribute("type").getValue();
+                int t = 0;
+                while (t < kCreatureTypeCount && AquariumCreatureTypeToString(static_cast<AquariumCreatureType>(t)) != type) ++t;
+                if (t == kCreatureTypeCount) {
+                    AQ_LOG_WARNING() << path << ": unknown fish type \"" << type << "\" in level " << settings.levels.size() << std::endl;
+                    continue;
+                }
+                level->setPopulation(static_cast<AquariumCreatureType>(t), fish.getAttribute("count").getIntValue());
+            }
+            settings.levels.push_back(std::move(level));
         }
     }
-    return toRepopulate;
+    if (settings.levels.empty()) {
+        settings.levels = {
+            std::make_shared<Level_0>(0, 10), std::make_shared<Level_1>(1, 15), std::make_shared<Level_2>(2, 20),
+            std::make_shared<Level_3>(3, 25), std::make_shared<Level_4>(4, 30), std::make_shared<Level_5>(5, 35),
+        };
+    }
+    return settings;
 }
@@ -1,10 +1,14 @@
 #define NOMINMAX // To avoid min/max macro conflict on Windows
 
+#include <cstddef>
 #include <vector>
 #include <memory>
 #include <iostream>
 #include <algorithm>
 #include "Core.h"
+#include "WorkerPool.h"
+#include "Random.h"
+#include "MoveKernels.h"
 
 
 enum class AquariumCreatureType {
@@ -14,6 +18,7 @@ enum class AquariumCreatureType {
     Angelfish,
     Surgeonfish,
 };
+const int kCreatureTypeCount = 5;
 
 enum class PowerUpType { SpeedBoost };
 
@@ -34,24 +39,32 @@ class AquariumLevelPopulationNode{
             this->population = population;
             this->currentPopulation = 0;
         };
-        AquariumCreatureType creatureType;
-        int population;
-        int currentPopulation;
+        AquariumCreatureType creatureType = AquariumCreatureType::NPCreature;
+        int population = 0;
+        int currentPopulation = 0;
 };
 
+// The level's population is one node per species, indexed by (int)AquariumCreatureType,
+// so eating a fish and refilling the tank go straight to the species' counters instead of
+// searching a list. Species the level does not use just have a population of 0.
 class AquariumLevel : public GameLevel {
     public:
-        AquariumLevel(int levelNumber, int targetScore)
-        : GameLevel(levelNumber), m_level_score(0), m_targetScore(targetScore){};
+        AquariumLevel(int levelNumber, int targetScore);
+        void setPopulation(AquariumCreatureType creature, int population);
+        int getPopulation(AquariumCreatureType creature) const { return m_levelPopulation[(int)creature].population; }
+        int getTargetScore() const { return m_targetScore; }
         void ConsumePopulation(AquariumCreatureType creature, int power);
         bool isCompleted() override;
         void populationReset();
         void levelReset(){m_level_score=0;this->populationReset();}
-        virtual std::vector<AquariumCreatureType> Repopulate();
+        // fills missing[type] with the fish of each species to spawn and counts them as alive;
+        // returns the total
+        int Repopulate(int missing[kCreatureTypeCount]);
     protected:
-        std::vector<std::shared_ptr<AquariumLevelPopulationNode>> m_levelPopulation;
+        AquariumLevelPopulationNode m_levelPopulation[kCreatureTypeCount];
         int m_level_score;
         int m_targetScore;
+        friend class AquariumSnapshot;
 
 };
 
@@ -61,14 +74,15 @@ public:
     PlayerCreature(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
     void move() override;
     void draw() const override;
+    void draw(float alpha) const; // between the position before and after the last update()
     void update();
     void changeSpeed(int speed);
     void setLives(int lives) { m_lives = lives; }
     void setDirection(float dx, float dy);
     float isXDirectionActive() { return m_dx != 0; }
     float isYDirectionActive() { return m_dy != 0; }
-    float getDx() { return m_dx; }
-    float getDy() { return m_dy; }
+    float getDx() const { return m_dx; }
+    float getDy() const { return m_dy; }
 
     int getScore() const { return m_score; }
     int getLives() const { return m_lives; }
@@ -94,14 +108,44 @@ private:
 
     int   m_baseSpeed = 0;
     int   m_speedBoostFrames = 0;
+    float m_prevX = 0.0f;
+    float m_prevY = 0.0f;
     int   m_speedCap = 0;
 
     float m_dx = 0.0f;
     float m_dy = 0.0f;
 
     bool  m_hasEatenFish = false;
+
+    friend class AquariumSnapshot;
+};
+
+
+// The fish move on every fixed Step(), but their speeds and timings were tuned back when
+// they moved once every kStepsPerFishMove steps. The step functions scale each per-move
+// rate by kFishStepScale, and stretch tick counts by kStepsPerFishMove, so a fish covers
+// the same path in the same time, in small steps.
+constexpr int kStepsPerFishMove = 6;
+constexpr float kFishStepScale = 1.0f / kStepsPerFishMove;
+
+// References to one fish's movement state. The species step functions take this
+// so the same code runs on a creature's own fields or on a CreatureStore row.
+struct FishState {
+    float& x;
+    float& y;
+    float& dx;
+    float& dy;
+    int&   speed;
+    float& radius;
+    int&   tick;     // PufferFish / Surgeonfish
+    float& phase;    // Angelfish
+    float& targetX;  // Surgeonfish
+    float& targetY;
+    uint32_t& id;    // keys the fish's GameRandom stream, together with tick
 };
 
+void copyFishState(FishState dst, const FishState& src);
+
 
 class NPCreature : public Creature {
 public:
@@ -109,9 +153,28 @@ public:
     AquariumCreatureType GetType() {return this->m_creatureType;}
     void move() override;
     void draw() const override;
+    FishState state();
+    static void step(FishState& s, float limitW, float limitH);
+    // straight line at speed * speedScale, then bounce off the bounds
+    static void moveStraight(FishState& s, float speedScale, float limitW, float limitH);
+    CreatureHandle getHandle() const { return m_handle; } // null until added to an Aquarium
+    uint32_t getId() const { return m_id; }
 protected:
     AquariumCreatureType m_creatureType;
+    // species specific state lives here so it can be copied to/from the CreatureStore
+    int   m_tick = 0;
+    float m_phase = 0.0f;
+    float m_targetX = 0.0f;
+    float m_targetY = 0.0f;
+    uint32_t m_id; // from GameRandom::nextCreatureId(), never reused
+
+    float limitW() const { return (m_width  > 0.0f) ? m_width  : WorldBounds::width()  - 20.0f; }
+    float limitH() const { return (m_height > 0.0f) ? m_height : WorldBounds::height() - 20.0f; }
 
+private:
+    bool m_viewPending = false; // handed out by Aquarium::getCreatureAt, not yet written back
+    CreatureHandle m_handle;
+    friend class Aquarium;
 };
 
 class BiggerFish : public NPCreature {
@@ -119,6 +182,7 @@ public:
     BiggerFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
     void move() override;
     void draw() const override;
+    static void step(FishState& s, float limitW, float limitH);
 };
 
 //####################### New Fishes ####################################################
@@ -127,12 +191,16 @@ public:
     PufferFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
     void move() override;
     void draw() const override;
+    static void step(FishState& s, float limitW, float limitH); // inflate, swim, turnAtEdge
+    static void inflate(FishState& s);
+    static void swim(FishState& s, float limitW, float limitH);
+    static void turnAtEdge(FishState& s, float limitW, float limitH);
+    static constexpr int inflatedRadius() { return (int)kInflatedRadius; }
 private:
-    int   m_tick;
-    int   m_cycleLen;
-    int   m_inflateLen;
-    float m_baseRadius;
-    float m_inflatedRadius;
+    static constexpr int   kCycleLen = 150 * kStepsPerFishMove;
+    static constexpr int   kInflateLen = 45 * kStepsPerFishMove;
+    static constexpr float kBaseRadius = 38.0f;
+    static constexpr float kInflatedRadius = 54.0f;
 };
 
 class Angelfish : public NPCreature {
@@ -140,8 +208,10 @@ public:
     Angelfish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
     void move() override;
     void draw() const override;
-private:
-    float m_phase;
+    static void step(FishState& s, float limitW, float limitH);
+    // vertical drift per unit of dy; a fish schooling has not turned (dy = 1/sqrt(1.25)
+    // from the constructor) drifts at 1.2, like it always did
+    static constexpr float kDrift = 1.2f / 0.894427191f;
 };
 
 class Surgeonfish : public NPCreature {
@@ -149,17 +219,267 @@ public:
     Surgeonfish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
     void move() override;
     void draw() const override;
+    static void step(FishState& s, float limitW, float limitH);
 private:
-    int   m_tick;
-    float m_targetX, m_targetY;
     static float clampf(float v, float lo, float hi) { return std::max(lo, std::min(v, hi)); }
 };
 
 
+// Structure-of-arrays storage for every fish in the aquarium. Each field is its
+// own contiguous array so Aquarium::update() walks memory linearly instead of
+// chasing one heap pointer per fish. Rows are kept grouped by species, so each
+// species' step function runs as one loop over its own range with no dispatch.
+struct CreatureStore {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> prevX; // x/y before the last Aquarium::update(), for interpolated drawing
+    std::vector<float> prevY;
+    std::vector<float> dx;
+    std::vector<float> dy;
+    std::vector<int>   speed;
+    std::vector<float> radius;
+    std::vector<int>   value;
+    std::vector<AquariumCreatureType> species;
+    std::vector<int>   tick;
+    std::vector<float> phase;
+    std::vector<float> targetX;
+    std::vector<float> targetY;
+    std::vector<uint32_t> id;
+    std::vector<uint32_t> slot; // CreatureSlotMap slot that points at this row
+    size_t speciesBegin[kCreatureTypeCount] = {}; // first row of each species' range
+
+    size_t size() const { return x.size(); }
+    size_t speciesEnd(int t) const { return t + 1 < kCreatureTypeCount ? speciesBegin[t + 1] : size(); }
+    FishState row(size_t i) {
+        return FishState{x[i], y[i], dx[i], dy[i], speed[i], radius[i],
+                         tick[i], phase[i], targetX[i], targetY[i], id[i]};
+    }
+    // Insert/remove keep the grouping by moving at most one row per species; moved(from, to)
+    // is called for each row that changes place so the owner can follow it.
+    template <class OnMove>
+    size_t insert(AquariumCreatureType type, OnMove&& moved);
+    template <class OnMove>
+    void remove(size_t i, OnMove&& moved);
+    void moveRow(size_t from, size_t to) { forEachColumn([from, to](auto& col) { col[to] = col[from]; }); }
+    void clear() {
+        forEachColumn([](auto& col) { col.clear(); });
+        std::fill(std::begin(speciesBegin), std::end(speciesBegin), 0);
+    }
+    void reserve(size_t n) { forEachColumn([n](auto& col) { col.reserve(n); }); }
+
+    // new columns only need to be listed here
+    template <class F>
+    void forEachColumn(F&& f) {
+        f(x); f(y); f(prevX); f(prevY); f(dx); f(dy); f(speed); f(radius); f(value); f(species);
+        f(tick); f(phase); f(targetX); f(targetY); f(id); f(slot);
+    }
+    template <class F>
+    void forEachColumn(F&& f) const { const_cast<CreatureStore*>(this)->forEachColumn([&f](const auto& col) { f(col); }); }
+};
+
+
+template <class OnMove>
+size_t CreatureStore::insert(AquariumCreatureType type, OnMove&& moved) {
+    // open a row at the end, then walk it down to the end of `type`'s range by moving
+    // the first row of every later species to the end of that species
+    forEachColumn([](auto& col) { col.emplace_back(); });
+    size_t hole = size() - 1;
+    for (int s = kCreatureTypeCount - 1; s > static_cast<int>(type); --s) {
+        const size_t first = speciesBegin[s];
+        if (first != hole) {
+            moveRow(first, hole);
+            moved(first, hole);
+        }
+        hole = first;
+        speciesBegin[s] = first + 1;
+    }
+    species[hole] = type;
+    return hole;
+}
+
+template <class OnMove>
+void CreatureStore::remove(size_t i, OnMove&& moved) {
+    // fill i from the end of its own range, then move that hole up to the end of the
+    // store by moving the last row of every later species to its front
+    const int type = static_cast<int>(species[i]);
+    size_t hole = i;
+    for (int s = type; s < kCreatureTypeCount; ++s) {
+        if (s != type) --speciesBegin[s];
+        const size_t last = speciesEnd(s) - 1;
+        if (last != hole) {
+            moveRow(last, hole);
+            moved(last, hole);
+        }
+        hole = last;
+    }
+    forEachColumn([](auto& col) { col.pop_back(); });
+}
+
+
+// Fixed-size block pool the aquarium's creatures are allocated from, object and
+// shared_ptr control block together (see CreatureArenaAllocator). Freed blocks are
+// reused by the next spawn, and when the last block is freed, which is what a level
+// transition does, the arena rewinds in one step instead of freeing block by block.
+// Memory only comes from the global allocator a chunk at a time, counted by
+// heapAllocations(), so steady state respawning costs no heap calls.
+class CreatureArena {
+public:
+    static constexpr size_t kBlockSize = 256;
+    static constexpr size_t kBlocksPerChunk = 256;
+
+    CreatureArena() = default;
+    CreatureArena(const CreatureArena&) = delete;
+    CreatureArena& operator=(const CreatureArena&) = delete;
+
+    void* allocate();
+    void deallocate(void* block);
+
+    size_t live() const { return m_live; }
+    size_t capacity() const { return m_chunks.size() * kBlocksPerChunk; }
+    size_t heapAllocations() const { return m_heapAllocations; }
+
+private:
+    struct FreeBlock { FreeBlock* next; };
+
+    std::vector<std::unique_ptr<unsigned char[]>> m_chunks;
+    size_t m_bumpChunk = 0;  // next never-used block is m_chunks[m_bumpChunk][m_bumpBlock]
+    size_t m_bumpBlock = 0;
+    FreeBlock* m_free = nullptr;
+    size_t m_live = 0;
+    size_t m_heapAllocations = 0;
+};
+
+// std::allocate_shared allocator that takes its single block from a CreatureArena.
+// It keeps the arena alive until the last creature allocated from it is gone.
+template <class T>
+class CreatureArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit CreatureArenaAllocator(std::shared_ptr<CreatureArena> arena) : m_arena(std::move(arena)) {}
+    template <class U>
+    CreatureArenaAllocator(const CreatureArenaAllocator<U>& other) : m_arena(other.m_arena) {}
+
+    T* allocate(size_t n) {
+        static_assert(sizeof(T) <= CreatureArena::kBlockSize, "creature does not fit an arena block");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "creature is over-aligned for the arena");
+        if (n != 1) throw std::bad_alloc();
+        return static_cast<T*>(m_arena->allocate());
+    }
+    void deallocate(T* p, size_t) { m_arena->deallocate(p); }
+
+    template <class U>
+    bool operator==(const CreatureArenaAllocator<U>& other) const { return m_arena == other.m_arena; }
+    template <class U>
+    bool operator!=(const CreatureArenaAllocator<U>& other) const { return m_arena != other.m_arena; }
+
+    std::shared_ptr<CreatureArena> m_arena;
+};
+
+
+// Generational slot map from CreatureHandle to CreatureStore row. Rows move when
+// fish are removed (swap and pop), handles do not.
+class CreatureSlotMap {
+public:
+    CreatureHandle acquire(int row);
+    void release(CreatureHandle handle);
+    void setRow(uint32_t slot, int row) { m_row[slot] = row; }
+    CreatureHandle handleOf(uint32_t slot) const { return CreatureHandle{slot, m_generation[slot]}; }
+    // -1 for null handles and handles whose creature is gone
+    int rowOf(CreatureHandle handle) const {
+        if (handle.isNull() || handle.index >= m_generation.size()) return -1;
+        if (m_generation[handle.index] != handle.generation) return -1;
+        return m_row[handle.index];
+    }
+
+private:
+    std::vector<int> m_row;
+    std::vector<uint32_t> m_generation;
+    std::vector<uint32_t> m_free;
+    friend class AquariumSnapshot;
+};
+
+
+// Uniform grid broadphase over the store. Cells are as wide as the largest collision
+// diameter, so two touching fish always sit in the same or neighbouring cells. It is
+// rebuilt with a counting sort each tick; the arrays are reused, so no allocation
+// happens once the population is stable.
+class CollisionGrid {
+public:
+    void build(const CreatureStore& store, float width, float height);
+
+    // calls visit(row) for every fish whose circle overlaps (cx, cy, r)
+    template <class Visit>
+    void forEachOverlap(float cx, float cy, float r, Visit&& visit) const;
+    // forEachOverlap limited to one species; visit(row, cx, cy, dx, dy) gets the fish as they
+    // were at build(), so it is safe to call while the store is being stepped
+    template <class Visit>
+    void forEachNeighbour(AquariumCreatureType species, float cx, float cy, float r, Visit&& visit) const;
+    // every pair of overlapping fish, each pair once as (rowA, rowB)
+    void findPairs(std::vector<std::pair<int, int>>& out) const;
+
+    float cellSize() const { return m_cellSize; }
+    float maxRadius() const { return m_maxRadius; }
+    void setKernels(const MoveKernels& kernels) { m_kernels = &kernels; }
+
+private:
+    int cellCol(float cx) const { return std::max(0, std::min(m_cols - 1, (int)(cx / m_cellSize))); }
+    int cellRow(float cy) const { return std::max(0, std::min(m_rows - 1, (int)(cy / m_cellSize))); }
+    void testCellPairs(int cellA, int cellB, std::vector<std::pair<int, int>>& out) const;
+    template <class Visit>
+    void forEachPacked(float cx, float cy, float r, Visit&& visit) const; // visit(k), k into the packed arrays
+
+    float m_cellSize = 1.0f;
+    float m_maxRadius = 0.0f;
+    int m_cols = 0;
+    int m_rows = 0;
+    std::vector<int> m_cellStart; // entries of cell c are [m_cellStart[c], m_cellStart[c+1])
+    std::vector<int> m_fill;
+    std::vector<int> m_cellOf;
+    // packed in cell order
+    std::vector<int>   m_row;
+    std::vector<float> m_cx;
+    std::vector<float> m_cy;
+    std::vector<float> m_r;
+    std::vector<float> m_dx;
+    std::vector<float> m_dy;
+    std::vector<AquariumCreatureType> m_species;
+    const MoveKernels* m_kernels = &MoveKernels::best();
+};
+
+template <class Visit>
+void CollisionGrid::forEachOverlap(float cx, float cy, float r, Visit&& visit) const {
+    forEachPacked(cx, cy, r, [&](int k) { visit(m_row[k]); });
+}
+
+template <class Visit>
+void CollisionGrid::forEachNeighbour(AquariumCreatureType species, float cx, float cy, float r, Visit&& visit) const {
+    forEachPacked(cx, cy, r, [&](int k) {
+        if (m_species[k] == species) visit(m_row[k], m_cx[k], m_cy[k], m_dx[k], m_dy[k]);
+    });
+}
+
+template <class Visit>
+void CollisionGrid::forEachPacked(float cx, float cy, float r, Visit&& visit) const {
+    if (m_row.empty()) return;
+    const float reach = r + m_maxRadius;
+    const int c0 = cellCol(cx - reach), c1 = cellCol(cx + reach);
+    const int r0 = cellRow(cy - reach), r1 = cellRow(cy + reach);
+    for (int row = r0; row <= r1; ++row) {
+        // cells c0..c1 of one grid row sit next to each other in the packed arrays
+        const int begin = m_cellStart[row * m_cols + c0];
+        const int end = m_cellStart[row * m_cols + c1 + 1];
+        forEachCircleOverlap(*m_kernels, cx, cy, r, m_cx.data() + begin, m_cy.data() + begin, m_r.data() + begin,
+                             end - begin, [&](size_t k) { visit(begin + (int)k); });
+    }
+}
+
 
 class AquariumSpriteManager {
     public:
         AquariumSpriteManager();
+        // empty sprites, filled in by the loader; fish just don't show until theirs is uploaded
+        explicit AquariumSpriteManager(AssetLoader& loader);
         ~AquariumSpriteManager() = default;
         std::shared_ptr<GameSprite>GetSprite(AquariumCreatureType t);
         std::shared_ptr<GameSprite> GetPowerUpSprite(PowerUpType t) { return m_speed_powerup; }
@@ -176,25 +496,67 @@ class AquariumSpriteManager {
 class Aquarium{
 public:
     Aquarium(int width, int height, std::shared_ptr<AquariumSpriteManager> spriteManager);
-    void addCreature(std::shared_ptr<Creature> creature);
+    CreatureHandle addCreature(std::shared_ptr<NPCreature> creature);
     void addAquariumLevel(std::shared_ptr<AquariumLevel> level);
     void removeCreature(std::shared_ptr<Creature> creature);
-    void clearCreatures();
+    bool removeCreature(CreatureHandle handle); // false if the handle is stale
+    void clearCreatures(); // raises nothing, see setEventQueue
     void update();
-    void draw() const;
+    // alpha 0 draws the fish where they were before the last update(), 1 where they are now
+    void draw(float alpha = 1.0f) const;
     void setBounds(int w, int h) { m_width = w; m_height = h; }
     void setMaxPopulation(int n) { m_maxPopulation = n; }
+    // threads used by update() to move the fish, counting the calling thread (1 = serial).
+    // Fish only draw from their own GameRandom stream, so the result is the same either way.
+    void setUpdateThreads(int threads);
+    int getUpdateThreads() const { return m_workers ? m_workers->threadCount() : 1; }
+    // defaults to MoveKernels::best(); every set gives the same result, only the speed differs
+    void setMoveKernels(const MoveKernels& kernels) { m_kernels = &kernels; m_grid.setKernels(kernels); }
+    const MoveKernels& getMoveKernels() const { return *m_kernels; }
+    // NPCreature and Angelfish school with the fish of their own species (on by default)
+    void setSchooling(bool on) { m_schooling = on; }
+    bool isSchooling() const { return m_schooling; }
+    static constexpr float kSchoolRadius = 90.0f;
+    // Tops the tank up to the current level's population, moving to the next level first
+    // if this one is completed. Spawns at most the spawn budget per call, the rest waits
+    // for the next update(), so a big level fills in over a few frames instead of one.
     void Repopulate();
     void SpawnCreature(AquariumCreatureType type);
+    // fish spawned per Repopulate() call, 0 = all at once. A count and not a time, so
+    // replays stay deterministic.
+    void setSpawnBudget(int fishPerTick) { m_spawnBudget = std::max(0, fishPerTick); }
+    int getSpawnBudget() const { return m_spawnBudget; }
+    int getPendingSpawns() const { return m_pendingSpawnTotal; }
+    static constexpr int kDefaultSpawnBudget = 256;
     
+    // The returned creature is a view of row `index` of the store. Changes made to it
+    // are written back on the next update()/removeCreature(), so only hold it for a tick.
     std::shared_ptr<Creature> getCreatureAt(int index);
-    int getCreatureCount() const { return m_creatures.size(); }
+    std::shared_ptr<Creature> getCreature(CreatureHandle handle) { return getCreatureAt(m_slots.rowOf(handle)); }
+    int getCreatureCount() const { return (int)m_store.size(); }
+    bool isAlive(CreatureHandle handle) const { return m_slots.rowOf(handle) >= 0; }
+    int getCreatureRow(CreatureHandle handle) const { return m_slots.rowOf(handle); }
+    CreatureHandle getCreatureHandle(int index) const { return m_slots.handleOf(m_store.slot[index]); }
+    const CreatureStore& getStore() const { return m_store; }
+    // the store as the next update() will see it, with what was done to the views from
+    // getCreatureAt written back; only copies (into scratch) while such views are out
+    const CreatureStore& getSyncedStore(CreatureStore& scratch) const;
+    // grid over the current rows, rebuilt here if fish were added or removed since update()
+    const CollisionGrid& getCollisionGrid();
+    void findCreatureContacts(std::vector<std::pair<int, int>>& out) { getCollisionGrid().findPairs(out); }
     int getWidth() const { return m_width; }
     int getHeight() const { return m_height; }
+    const CreatureArena& getArena() const { return *m_arena; }
 
     int  getPowerUpCount() const { return (int)m_powerups.size(); }
     const std::vector<PowerUpItem>& getPowerUps() const { return m_powerups; }
     void removePowerUpAt(size_t idx);
+    static constexpr int kMaxPowerUps = 2;
+    // CREATURE_ADDED, CREATURE_REMOVED and NEW_LEVEL go here (the game scene's queue); null drops them.
+    // Replacing the whole tank (a level change, a snapshot load) raises one NEW_LEVEL and no
+    // CREATURE_REMOVED/ADDED per fish, which would not fit the queue; subscribers that track
+    // the live fish start over on NEW_LEVEL.
+    void setEventQueue(GameEventQueue* events) { m_events = events; }
 
 
 private:
@@ -202,38 +564,100 @@ private:
     int m_width;
     int m_height;
     int currentLevel = 0;
-    std::vector<std::shared_ptr<Creature>> m_creatures;
+    CreatureStore m_store;
+    CreatureSlotMap m_slots;
+    std::shared_ptr<CreatureArena> m_arena = std::make_shared<CreatureArena>();
+    std::vector<std::shared_ptr<NPCreature>> m_creatures; // m_creatures[i] is the view of m_store row i, null until viewAt(i)
+    std::vector<int> m_pendingViews;
+    CollisionGrid m_grid;
+    bool m_gridDirty = true;
+    std::unique_ptr<WorkerPool> m_workers; // null when update() runs serially
+    const MoveKernels* m_kernels = &MoveKernels::best();
+    bool m_schooling = true;
+    static constexpr size_t kParallelUpdateMinRows = 4096; // below this the hand-off costs more than it saves
+    static constexpr size_t kParallelUpdateChunk = 1024;
     std::vector<std::shared_ptr<Creature>> m_next_creatures;
     std::vector<std::shared_ptr<AquariumLevel>> m_aquariumlevels;
     std::shared_ptr<AquariumSpriteManager> m_sprite_manager;
 
     std::vector<PowerUpItem> m_powerups;
     int m_powerupSpawnTimer = 0;
+    uint64_t m_tick = 0;       // update() calls, keys the powerup stream
+    uint64_t m_spawnCount = 0; // SpawnCreature() calls, keys the spawn stream
+    int m_spawnBudget = kDefaultSpawnBudget;
+    int m_pendingSpawns[kCreatureTypeCount] = {}; // counted as alive by the level, not in the tank yet
+    int m_pendingSpawnTotal = 0;
+    GameEventQueue* m_events = nullptr;
+    void raise(const GameEvent& event) { if (m_events) m_events->push(event); }
     void maybeSpawnPowerUp();
+    void flushCreatureViews();
+    void relocateRow(size_t from, size_t to);
+    std::shared_ptr<NPCreature>& viewAt(size_t row);
+    template <class T>
+    std::shared_ptr<T> makeCreature(int x, int y, int speed, AquariumCreatureType type) {
+        return std::allocate_shared<T>(CreatureArenaAllocator<T>(m_arena), x, y, speed, m_sprite_manager->GetSprite(type));
+    }
+
+    mutable ofVboMesh m_batches[kCreatureTypeCount]; // rebuilt by draw(), one draw call per species
+
+    friend class AquariumSnapshot;
+};
+
+// What bin/data/settings.xml configures, read once at startup:
+//   <player_speed>5</player_speed>
+//   <levels>
+//     <level target="10"> <fish type="BaseFish" count="10"/> ... </level>
+//   </levels>
+// Fish types are the names AquariumCreatureTypeToString gives. Without a <levels> block
+// (or without the file) the built-in Level_0 to Level_5 are used.
+struct AquariumSettings {
+    int playerSpeed = 5;
+    std::vector<std::shared_ptr<AquariumLevel>> levels; // in play order
 };
+AquariumSettings LoadAquariumSettings(const std::string& path);
 
 
-std::shared_ptr<GameEvent> DetectAquariumCollisions(std::shared_ptr<Aquarium> aquarium, std::shared_ptr<PlayerCreature> player);
+// pushes one COLLISION event for every fish touching the player, returns how many
+int DetectAquariumCollisions(const std::shared_ptr<Aquarium>& aquarium, const std::shared_ptr<PlayerCreature>& player, GameEventQueue& events);
 
 
 class AquariumGameScene : public GameScene {
     public:
-        AquariumGameScene(std::shared_ptr<PlayerCreature> player, std::shared_ptr<Aquarium> aquarium, string name)
-        : m_player(std::move(player)) , m_aquarium(std::move(aquarium)), m_name(name){}
-        std::shared_ptr<GameEvent> GetLastEvent(){return m_lastEvent;}
-        void SetLastEvent(std::shared_ptr<GameEvent> event){this->m_lastEvent = event;}
+        AquariumGameScene(std::shared_ptr<PlayerCreature> player, std::shared_ptr<Aquarium> aquarium, string name);
+        ~AquariumGameScene();
+        const GameEvent& GetLastEvent() const {return m_lastEvent;}
+        void SetLastEvent(const GameEvent& event){this->m_lastEvent = event;}
         std::shared_ptr<PlayerCreature> GetPlayer(){return this->m_player;}
         std::shared_ptr<Aquarium> GetAquarium(){return this->m_aquarium;}
         string GetName()override {return this->m_name;}
+        // Runs as many fixed Step()s as the time since the last frame covers, so the
+        // game speed does not depend on the frame rate. Draw() interpolates between steps.
         void Update() override;
         void Draw() override;
+        void Step(); // one 1/60 s simulation tick, what replays and the headless runner call
+        static constexpr double kStepSeconds = 1.0 / 60.0;
+        // a slow frame runs at most this many steps and drops the rest, so it cannot snowball
+        void SetMaxCatchUpSteps(int steps) { m_maxCatchUpSteps = std::max(1, steps); }
+        // arrow keys steer the player; called by ofApp and by replays
+        void HandleKeyPressed(int key);
+        void HandleKeyReleased(int key);
+        uint64_t GetTick() const { return m_tick; } // Step() calls so far
+        // frame profiler zones over the HUD
+        void SetProfilerOverlay(bool on) { m_showProfiler = on; }
+        bool IsProfilerOverlayVisible() const { return m_showProfiler; }
     private:
         void paintAquariumHUD();
+        void OnCollision(const GameEvent& event);
+        void OnNewLevel(const GameEvent& event);
         std::shared_ptr<PlayerCreature> m_player;
         std::shared_ptr<Aquarium> m_aquarium;
-        std::shared_ptr<GameEvent> m_lastEvent;
+        GameEvent m_lastEvent;
+        GameEventQueue m_events; // this step's events, the aquarium raises into it too
         string m_name;
-        AwaitFrames updateControl{5};
+        uint64_t m_tick = 0;
+        double m_accumulator = 0.0; // frame time not yet simulated
+        int m_maxCatchUpSteps = 8;
+        bool m_showProfiler = false;
 };
 
 
@@ -241,10 +665,10 @@ class Level_0 : public AquariumLevel  {
 public:
     Level_0(int levelNumber, int targetScore) : AquariumLevel(levelNumber, targetScore) {
         // Base y un par de especies nuevas
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 10));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::PufferFish, 2));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::Angelfish, 3));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::Surgeonfish, 2));
+        setPopulation(AquariumCreatureType::NPCreature, 10);
+        setPopulation(AquariumCreatureType::PufferFish, 2);
+        setPopulation(AquariumCreatureType::Angelfish, 3);
+        setPopulation(AquariumCreatureType::Surgeonfish, 2);
     };
 };
 
@@ -252,11 +676,11 @@ class Level_1 : public AquariumLevel  {
 public:
     Level_1(int levelNumber, int targetScore) : AquariumLevel(levelNumber, targetScore) {
         // Más población y variedad
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 16));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::BiggerFish, 3));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::PufferFish, 3));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::Angelfish, 4));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::Surgeonfish, 3));
+        setPopulation(AquariumCreatureType::NPCreature, 16);
+        setPopulation(AquariumCreatureType::BiggerFish, 3);
+        setPopulation(AquariumCreatureType::PufferFish, 3);
+        setPopulation(AquariumCreatureType::Angelfish, 4);
+        setPopulation(AquariumCreatureType::Surgeonfish, 3);
     };
 };
 
@@ -264,11 +688,11 @@ class Level_2 : public AquariumLevel  {
 public:
     Level_2(int levelNumber, int targetScore) : AquariumLevel(levelNumber, targetScore) {
         // Nivel con todo
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 20));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::BiggerFish, 6));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::PufferFish, 4));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::Angelfish, 5));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::Surgeonfish, 4));
+        setPopulation(AquariumCreatureType::NPCreature, 20);
+        setPopulation(AquariumCreatureType::BiggerFish, 6);
+        setPopulation(AquariumCreatureType::PufferFish, 4);
+        setPopulation(AquariumCreatureType::Angelfish, 5);
+        setPopulation(AquariumCreatureType::Surgeonfish, 4);
     };
 };
 
@@ -277,10 +701,10 @@ public:
     Level_3(int levelNumber, int targetScore)
     : AquariumLevel(levelNumber, targetScore) {
         // más variedad, introducimos Puffer y Angelfish
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 18));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::BiggerFish, 6));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::PufferFish, 4));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::Angelfish, 6));
+        setPopulation(AquariumCreatureType::NPCreature, 18);
+        setPopulation(AquariumCreatureType::BiggerFish, 6);
+        setPopulation(AquariumCreatureType::PufferFish, 4);
+        setPopulation(AquariumCreatureType::Angelfish, 6);
     }
 };
 
@@ -289,10 +713,10 @@ public:
     Level_4(int levelNumber, int targetScore)
     : AquariumLevel(levelNumber, targetScore) {
         // metemos Surgeonfish y subimos densidad
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 20));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::BiggerFish, 8));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::Angelfish, 6));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::Surgeonfish, 6));
+        setPopulation(AquariumCreatureType::NPCreature, 20);
+        setPopulation(AquariumCreatureType::BiggerFish, 8);
+        setPopulation(AquariumCreatureType::Angelfish, 6);
+        setPopulation(AquariumCreatureType::Surgeonfish, 6);
     }
 };
 
@@ -301,11 +725,11 @@ public:
     Level_5(int levelNumber, int targetScore)
     : AquariumLevel(levelNumber, targetScore) {
         // ecosistema “adulto”: muchos peces y mezcla completa
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 22));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::BiggerFish, 10));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::PufferFish, 6));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::Angelfish, 8));
-        m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::Surgeonfish, 8));
+        setPopulation(AquariumCreatureType::NPCreature, 22);
+        setPopulation(AquariumCreatureType::BiggerFish, 10);
+        setPopulation(AquariumCreatureType::PufferFish, 6);
+        setPopulation(AquariumCreatureType::Angelfish, 8);
+        setPopulation(AquariumCreatureType::Surgeonfish, 8);
     }
 };
 
@@ -0,0 +1,87 @@
+#include "AssetLoader.h"
+#include "Core.h"
+#include <algorithm>
+#include <chrono>
+
+AssetLoader::AssetLoader(int threads) {
+    for (int i = 0; i < std::max(1, threads); ++i) {
+        m_workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+        m_toLoad.clear();
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) worker.join();
+}
+
+void AssetLoader::add(std::function<void()> load, std::function<void()> finish) {
+    auto asset = std::make_shared<Asset>();
+    asset->load = std::move(load);
+    asset->finish = std::move(finish);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_toFinish.push_back(asset);
+        m_toLoad.push_back(std::move(asset));
+        ++m_total;
+    }
+    m_wake.notify_one();
+}
+
+void AssetLoader::addSprite(const std::shared_ptr<GameSprite>& sprite, const std::string& imagePath, int width, int height) {
+    add([sprite, imagePath, width, height] { sprite->loadPixels(imagePath, width, height); },
+        [sprite] { sprite->upload(); });
+}
+
+void AssetLoader::addImage(ofImage& image, const std::string& imagePath, int width, int height, std::function<void()> done) {
+    ofImage* target = &image;
+    add([target, imagePath, width, height] {
+            target->setUseTexture(false);
+            if (!ImageCache::load(*target, imagePath, width, height)) {
+                std::cerr << "Failed to load image: " << imagePath << std::endl;
+            }
+        },
+        [target, done] {
+            target->setUseTexture(true);
+            target->update();
+            if (done) done();
+        });
+}
+
+void AssetLoader::update(double budgetMillis) {
+    const auto start = std::chrono::steady_clock::now();
+    for (;;) {
+        std::shared_ptr<Asset> asset;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            // the first one that is loaded, a slow asset does not hold back the ones after it
+            auto ready = std::find_if(m_toFinish.begin(), m_toFinish.end(),
+                                      [](const std::shared_ptr<Asset>& a) { return a->loaded; });
+            if (ready == m_toFinish.end()) return;
+            asset = std::move(*ready);
+            m_toFinish.erase(ready);
+        }
+        if (asset->finish) asset->finish();
+        ++m_finished;
+        const double spent = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (spent >= budgetMillis) return; // the rest waits for the next frame
+    }
+}
+
+void AssetLoader::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_quit || !m_toLoad.empty(); });
+        if (m_quit) return;
+        std::shared_ptr<Asset> asset = std::move(m_toLoad.front());
+        m_toLoad.pop_front();
+        lock.unlock();
+        if (asset->load) asset->load();
+        lock.lock();
+        asset->loaded = true;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ofMain.h"
+
+class GameSprite;
+
+// Loads the game's assets while the first frames are already on screen. Each asset is a
+// load step that runs on a loader thread (file reads, PNG and audio decoding) and an
+// optional finish step that runs on the main thread from update() (texture uploads,
+// anything else that needs the GL context). update() stops starting finish steps once
+// its time budget for the frame is used, so a long list of assets never stalls a frame.
+class AssetLoader {
+public:
+    explicit AssetLoader(int threads = 2);
+    ~AssetLoader(); // waits for the load steps already running, drops the rest
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // assets start loading in the order they are added and finish as soon as they are loaded
+    void add(std::function<void()> load, std::function<void()> finish = {});
+    void addSprite(const std::shared_ptr<GameSprite>& sprite, const std::string& imagePath, int width, int height);
+    // pixels on a loader thread, texture on the main thread; done() is called after the upload
+    void addImage(ofImage& image, const std::string& imagePath, int width, int height, std::function<void()> done = {});
+
+    // runs finish steps that are ready, on the main thread, until budgetMillis have passed
+    void update(double budgetMillis);
+
+    int total() const { return m_total; }
+    int finished() const { return m_finished; }
+    float progress() const { return m_total > 0 ? (float)m_finished / m_total : 1.0f; }
+    bool isDone() const { return m_finished == m_total; }
+
+private:
+    struct Asset {
+        std::function<void()> load;
+        std::function<void()> finish;
+        bool loaded = false;
+    };
+
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::shared_ptr<Asset>> m_toLoad;   // waiting for a loader thread
+    std::deque<std::shared_ptr<Asset>> m_toFinish; // in add() order, the first loaded one finishes next
+    bool m_quit = false;
+    int m_total = 0;
+    int m_finished = 0;
+};
@@ -1,6 +1,11 @@
 #include "Core.h"
+#include "Profiler.h"
+#include "Log.h"
 
 
+int WorldBounds::s_width = 1024;
+int WorldBounds::s_height = 768;
+
 // Creature Inherited Base Behavior
 void Creature::setBounds(int w, int h) { m_width = w; m_height = h; }
 void Creature::normalize() {
@@ -12,33 +17,36 @@ void Creature::normalize() {
 }
 
 void Creature::bounce() {
-    // Use collision circle diameter if no sprite size is available
-    const float sw = (m_collisionRadius > 0.0f) ? (m_collisionRadius * 2.0f) : 20.0f;
-    const float sh = (m_collisionRadius > 0.0f) ? (m_collisionRadius * 2.0f) : 20.0f;
+    // Use the bounds set by Aquarium::setBounds; if zero, fall back to the world size
+    const float limitW = (m_width  > 0.0f) ? m_width  : static_cast<float>(WorldBounds::width());
+    const float limitH = (m_height > 0.0f) ? m_height : static_cast<float>(WorldBounds::height());
+    bounceInBounds(m_x, m_y, m_dx, m_dy, m_collisionRadius, limitW, limitH);
+}
 
-    // Use the bounds set by Aquarium::setBounds; if zero, fall back to current window size
-    const float limitW = (m_width  > 0.0f) ? m_width  : static_cast<float>(ofGetWidth());
-    const float limitH = (m_height > 0.0f) ? m_height : static_cast<float>(ofGetHeight());
+void bounceInBounds(float& x, float& y, float& dx, float& dy, float radius, float limitW, float limitH) {
+    // Use collision circle diameter if no sprite size is available
+    const float sw = (radius > 0.0f) ? (radius * 2.0f) : 20.0f;
+    const float sh = (radius > 0.0f) ? (radius * 2.0f) : 20.0f;
 
     const float maxX = std::max(0.0f, limitW - sw);
     const float maxY = std::max(0.0f, limitH - sh);
 
     // Horizontal
-    if (m_x < 0.0f) {
-        m_x = 0.0f;
-        m_dx = -m_dx;
-    } else if (m_x > maxX) {
-        m_x = maxX;
-        m_dx = -m_dx;
+    if (x < 0.0f) {
+        x = 0.0f;
+        dx = -dx;
+    } else if (x > maxX) {
+        x = maxX;
+        dx = -dx;
     }
 
     // Vertical
-    if (m_y < 0.0f) {
-        m_y = 0.0f;
-        m_dy = -m_dy;
-    } else if (m_y > maxY) {
-        m_y = maxY;
-        m_dy = -m_dy;
+    if (y < 0.0f) {
+        y = 0.0f;
+        dy = -dy;
+    } else if (y > maxY) {
+        y = maxY;
+        dy = -dy;
     }
 }
 
@@ -48,34 +56,59 @@ void GameEvent::print() const {
         
         switch (type) {
             case GameEventType::NONE:
-                ofLogVerbose() << "No event." << std::endl;
+                AQ_LOG_VERBOSE() << "No event." << std::endl;
                 break;
             case GameEventType::COLLISION:
-                ofLogVerbose() << "Collision event between creatures at (" 
-                << creatureA->getX() << ", " << creatureA->getY() << ") and ("
-                << creatureB->getX() << ", " << creatureB->getY() << ")." << std::endl;
+                AQ_LOG_VERBOSE() << "Collision event between creatures " 
+                << creatureA.index << ":" << creatureA.generation << " and "
+                << creatureB.index << ":" << creatureB.generation << "." << std::endl;
                 break;
             case GameEventType::CREATURE_ADDED:
-                ofLogVerbose() << "Creature added at (" 
-                << creatureA->getX() << ", " << creatureA->getY() << ")." << std::endl;
+                AQ_LOG_VERBOSE() << "Creature added " 
+                << creatureA.index << ":" << creatureA.generation << "." << std::endl;
                 break;
             case GameEventType::CREATURE_REMOVED:
-                ofLogVerbose() << "Creature removed at (" 
-                << creatureA->getX() << ", " << creatureA->getY() << ")." << std::endl;
+                AQ_LOG_VERBOSE() << "Creature removed " 
+                << creatureA.index << ":" << creatureA.generation << "." << std::endl;
                 break;
             case GameEventType::GAME_OVER:
-                ofLogVerbose() << "Game Over event." << std::endl;
+                AQ_LOG_VERBOSE() << "Game Over event." << std::endl;
                 break;
             case GameEventType::NEW_LEVEL:
-                ofLogVerbose() << "New Game level" << std::endl;
+                AQ_LOG_VERBOSE() << "New Game level" << std::endl;
+                break;
             default:
-                ofLogVerbose() << "Unknown event type." << std::endl;
+                AQ_LOG_VERBOSE() << "Unknown event type." << std::endl;
                 break;
         }
 };
 
+void GameEventQueue::subscribe(GameEventType type, Handler fn, void* ctx) {
+    m_subscribers[(int)type].push_back(Subscriber{fn, ctx});
+}
+
+bool GameEventQueue::push(const GameEvent& event) {
+    if (m_count == kCapacity) {
+        ++m_dropped;
+        return false;
+    }
+    m_events[m_count++] = event;
+    return true;
+}
+
+void GameEventQueue::dispatch() {
+    // m_count can grow while this runs, handlers raise events too
+    for (int i = 0; i < m_count; ++i) {
+        const GameEvent event = m_events[i];
+        for (const Subscriber& s : m_subscribers[(int)event.type]) {
+            s.fn(s.ctx, event);
+        }
+    }
+    m_count = 0;
+}
+
 // collision detection between two creatures
-bool checkCollision(std::shared_ptr<Creature> a, std::shared_ptr<Creature> b) {
+bool checkCollision(const std::shared_ptr<Creature>& a, const std::shared_ptr<Creature>& b) {
     if (!a || !b) return false;
     const float ar = a->getCollisionRadius();
     const float br = b->getCollisionRadius();
@@ -104,54 +137,37 @@ std::string GameSceneKindToString(GameSceneKind t) {
     }
 }
 
-std::shared_ptr<GameScene> GameSceneManager::GetScene(string name){
-    if(!this->HasScenes()){return nullptr;}
-    for(std::shared_ptr<GameScene> scene : this->m_scenes){
-        if(scene->GetName() == name){
-            return scene;
-        }
-    }
-    return nullptr;
-}
-
-void GameSceneManager::Transition(string name){
+void GameSceneManager::Transition(GameSceneKind kind){
     if(!this->HasScenes()){return;} // no need to do anything if nothing inside
-    std::shared_ptr<GameScene> newScene = this->GetScene(name);
-    if(newScene == nullptr){return;} // i dont have the scene so time to leave
-    if(newScene->GetName() == this->m_active_scene->GetName()){return;} // another do nothing since active scene is already pulled
-    this->m_active_scene = newScene; // now we keep it since this is a valid transition
-    return;
+    if(this->m_scenes[(int)kind] == nullptr){return;} // i dont have the scene so time to leave
+    this->m_active = (int)kind;
 }
 
-void GameSceneManager::AddScene(std::shared_ptr<GameScene> newScene){
-    if(this->GetScene(newScene->GetName()) != nullptr){
+void GameSceneManager::AddScene(GameSceneKind kind, std::shared_ptr<GameScene> newScene){
+    if(newScene == nullptr || this->m_scenes[(int)kind] != nullptr){
         return; // this scene already exist and shouldnt be added again
     }
-    this->m_scenes.push_back(newScene);
-    if(m_active_scene == nullptr){
-        this->m_active_scene = newScene; // need to place in active scene as its the only one in existance right now
+    this->m_scenes[(int)kind] = std::move(newScene);
+    if(this->m_active < 0){
+        this->m_active = (int)kind; // need to place in active scene as its the only one in existance right now
     }
-    return;
-}
-
-std::shared_ptr<GameScene> GameSceneManager::GetActiveScene(){
-    return this->m_active_scene;
 }
 
 string GameSceneManager::GetActiveSceneName(){
-    if(this->m_active_scene == nullptr){return "";} // something to handle missing activate scenes
-    return this->m_active_scene->GetName();
+    if(!this->HasScenes()){return "";} // something to handle missing activate scenes
+    return this->GetActiveScene()->GetName();
 }
 
 void GameSceneManager::UpdateActiveScene(){
+    PROFILE_ZONE("GameSceneManager::UpdateActiveScene");
     if(!this->HasScenes()){return;} // make sure we have a scene before we try to paint
-    this->m_active_scene->Update();
+    this->GetActiveScene()->Update();
 
 }
 
 void GameSceneManager::DrawActiveScene(){
     if(!this->HasScenes()){return;} // make sure we have something before Drawing it
-    this->m_active_scene->Draw();
+    this->GetActiveScene()->Draw();
 }
 
 
@@ -160,7 +176,19 @@ void GameIntroScene::Update(){
 }
 
 void GameIntroScene::Draw(){
-    this->m_banner->draw(0,0);
+    this->m_banner->draw(0,0); // nothing until the loader has uploaded it
+    if(this->m_loader == nullptr || this->m_loader->isDone()){return;}
+    const float barWidth = ofGetWidth() * 0.4f;
+    const float x = (ofGetWidth() - barWidth) / 2;
+    const float y = ofGetHeight() * 0.85f;
+    ofPushStyle();
+    ofNoFill();
+    ofSetColor(ofColor::white);
+    ofDrawRectangle(x, y, barWidth, 12);
+    ofFill();
+    ofDrawRectangle(x, y, barWidth * this->m_loader->progress(), 12);
+    ofDrawBitmapString("Loading " + ofToString(this->m_loader->finished()) + "/" + ofToString(this->m_loader->total()), x, y - 8);
+    ofPopStyle();
 }
 
 void GameOverScene::Update(){
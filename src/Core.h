@@ -1,9 +1,13 @@
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <utility>
+#include <vector>
 #include <cmath>
 #include <algorithm>
 #include "ofMain.h"
+#include "ImageCache.h"
+#include "AssetLoader.h"
 
 
 class AwaitFrames {
@@ -22,35 +26,117 @@ private:
 	int m_counter;
 };
 
+// Size of the world the simulation runs in. The app keeps it in sync with the window
+// and the headless runner sets it once, so the simulation never has to ask the window.
+class WorldBounds {
+public:
+    static void set(int width, int height) { s_width = width; s_height = height; }
+    static int width() { return s_width; }
+    static int height() { return s_height; }
+private:
+    static int s_width;
+    static int s_height;
+};
+
+// One immutable image shared by every creature that uses it. Mirroring and tint are
+// per draw call, so creatures never need their own copy of the pixels.
 class GameSprite {
 public:
     GameSprite(const std::string& imagePath, int width, int height) {
-        if (!m_image.load(imagePath)) {
+#ifndef AQUARIUM_HEADLESS // no GL context to upload to, and nothing gets drawn anyway
+        if (!ImageCache::load(m_image, imagePath, width, height)) {
             std::cerr << "Failed to load image: " << imagePath << std::endl;
         }
-        m_image.resize(width, height);
-        m_flippedImage = m_image;
-        m_flippedImage.mirror(false, true); // Mirror horizontally
+        m_uv0 = m_image.getTexture().getCoordFromPoint(0, 0);
+        m_uv1 = m_image.getTexture().getCoordFromPoint(width, height);
+#endif
     }
 
-    void draw(float x, float y) const {
-        if (m_flipped) {
-            m_flippedImage.draw(x, y);
+    // An empty sprite for the AssetLoader to fill in: loadPixels() on a loader thread,
+    // upload() later on the main thread (which owns the GL context). Draws nothing until then.
+    GameSprite() : m_uploaded(false) {}
+
+    bool loadPixels(const std::string& imagePath, int width, int height) {
+#ifndef AQUARIUM_HEADLESS
+        m_image.setUseTexture(false);
+        if (!ImageCache::load(m_image, imagePath, width, height)) {
+            std::cerr << "Failed to load image: " << imagePath << std::endl;
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    void upload() {
+        if (m_uploaded) return;
+        m_uploaded = true;
+#ifndef AQUARIUM_HEADLESS
+        m_image.setUseTexture(true);
+        m_image.update();
+        m_uv0 = m_image.getTexture().getCoordFromPoint(0, 0);
+        m_uv1 = m_image.getTexture().getCoordFromPoint(m_image.getWidth(), m_image.getHeight());
+#endif
+    }
+    bool isUploaded() const { return m_uploaded; }
+
+    void draw(float x, float y) const { draw(x, y, false); }
+
+    // flipped mirrors horizontally by swapping the texture coordinates, not the pixels
+    void draw(float x, float y, bool flipped) const {
+#ifndef AQUARIUM_HEADLESS
+        if (!m_uploaded) return;
+        if (flipped) {
+            const float w = m_image.getWidth();
+            const float h = m_image.getHeight();
+            m_image.getTexture().drawSubsection(x, y, w, h, w, 0, -w, h);
         } else {
             m_image.draw(x, y);
         }
+#endif
+    }
+
+    void draw(float x, float y, bool flipped, const ofColor& tint) const {
+        ofSetColor(tint);
+        draw(x, y, flipped);
     }
 
-    void setFlipped(bool flipped) { m_flipped = flipped; }
+    // Batched drawing: append this sprite as two triangles to a mesh, then draw the
+    // whole mesh with the texture bound once. Flipping swaps the u coordinates.
+    void addToBatch(ofMesh& batch, float x, float y, bool flipped) const {
+        const float w = m_image.getWidth();
+        const float h = m_image.getHeight();
+        const float u0 = flipped ? m_uv1.x : m_uv0.x;
+        const float u1 = flipped ? m_uv0.x : m_uv1.x;
+        batch.addVertex(glm::vec3(x,     y,     0)); batch.addTexCoord(glm::vec2(u0, m_uv0.y));
+        batch.addVertex(glm::vec3(x + w, y,     0)); batch.addTexCoord(glm::vec2(u1, m_uv0.y));
+        batch.addVertex(glm::vec3(x + w, y + h, 0)); batch.addTexCoord(glm::vec2(u1, m_uv1.y));
+        batch.addVertex(glm::vec3(x,     y,     0)); batch.addTexCoord(glm::vec2(u0, m_uv0.y));
+        batch.addVertex(glm::vec3(x + w, y + h, 0)); batch.addTexCoord(glm::vec2(u1, m_uv1.y));
+        batch.addVertex(glm::vec3(x,     y + h, 0)); batch.addTexCoord(glm::vec2(u0, m_uv1.y));
+    }
+
+    void drawBatch(const ofVboMesh& batch) const {
+#ifndef AQUARIUM_HEADLESS
+        if (batch.getNumVertices() == 0 || !m_uploaded) return;
+        m_image.getTexture().bind();
+        batch.draw();
+        m_image.getTexture().unbind();
+#endif
+    }
 
 private:
     ofImage m_image;
-    ofImage m_flippedImage;
-    bool m_flipped = false;
+    glm::vec2 m_uv0; // texture coordinates of the top left and bottom right corners
+    glm::vec2 m_uv1;
+    bool m_uploaded = true;
 };
 
 
 
+// Clamp a box of side 2*radius (20 if no radius) inside [0, limitW] x [0, limitH],
+// flipping the direction component of whichever wall it hit
+void bounceInBounds(float& x, float& y, float& dx, float& dy, float radius, float limitW, float limitH);
+
 class Creature {
 protected:
     Creature(float x, float y, int speed, float collisionRadius, int value,
@@ -76,6 +162,9 @@ protected:
     float m_collisionRadius = 0.0f;
     int   m_value = 0;
     std::shared_ptr<GameSprite> m_sprite;
+    bool  m_flipped = false; // per creature, the sprite itself is shared
+
+    friend class Aquarium; // syncs its creature views with the CreatureStore rows
 
 public:
     virtual ~Creature() = default;
@@ -89,9 +178,8 @@ public:
     float getY() const { return m_y; }
     int   getSpeed() const { return m_speed; }
     void  setSpeed(int speed) { m_speed = speed; }
-    void  setFlipped(bool flipped) {
-        if (m_sprite) m_sprite->setFlipped(flipped);
-    }
+    void  setFlipped(bool flipped) { m_flipped = flipped; }
+    bool  isFlipped() const { return m_flipped; }
     void  setSprite(std::shared_ptr<GameSprite> sprite) { m_sprite = std::move(sprite); }
     int   getValue() const { return m_value; }
 
@@ -124,6 +212,18 @@ public:
 };
 
 
+// Stable name for a creature stored in the Aquarium, safe to keep across frames.
+// When the creature is removed its slot's generation moves on, so an old handle
+// stops resolving instead of pointing at whatever reuses the slot.
+struct CreatureHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0; // 0 is never handed out, so a default handle is null
+
+    bool isNull() const { return generation == 0; }
+    bool operator==(const CreatureHandle& o) const { return index == o.index && generation == o.generation; }
+    bool operator!=(const CreatureHandle& o) const { return !(*this == o); }
+};
+
 // GameEvents
 enum class GameEventType {
     NONE,
@@ -138,14 +238,14 @@ enum class GameEventType {
 class GameEvent {
     public:
     GameEventType type;
-    std::shared_ptr<Creature> creatureA;
-    std::shared_ptr<Creature> creatureB; // For collision events
-    GameEvent() : type(GameEventType::NONE), creatureA(nullptr), creatureB(nullptr) {}
-    GameEvent(GameEventType t, std::shared_ptr<Creature> a , std::shared_ptr<Creature> b){
-        type = t;
-        creatureA = a;
-        creatureB = b;
-    }
+    // For collision events creatureA is the player, which is not stored in the
+    // aquarium and so has a null handle, and creatureB is the fish it touched
+    CreatureHandle creatureA;
+    CreatureHandle creatureB;
+    int value = 0; // NEW_LEVEL: the level index (the tank was refilled, also after a snapshot load)
+    GameEvent() : type(GameEventType::NONE) {}
+    GameEvent(GameEventType t, CreatureHandle a, CreatureHandle b, int v = 0)
+    : type(t), creatureA(a), creatureB(b), value(v) {}
     
     // Additional methods can be added here
     bool isCollisionEvent() const { return type == GameEventType::COLLISION; }
@@ -159,10 +259,46 @@ class GameEvent {
     void print() const;
 };
 
+// Events raised during one simulation step. They are plain values in a fixed array, so
+// raising one never allocates; past kCapacity in a step they are dropped and counted.
+// dispatch() hands each event to the handlers subscribed to its type, in the order the
+// events were raised, including events raised by the handlers themselves, then empties
+// the queue.
+class GameEventQueue {
+public:
+    static constexpr int kCapacity = 1024;
+    using Handler = void (*)(void* ctx, const GameEvent& event);
+
+    void subscribe(GameEventType type, Handler fn, void* ctx);
+    // subscribe<&Scene::OnCollision>(GameEventType::COLLISION, this)
+    template <auto Method, class Obj>
+    void subscribe(GameEventType type, Obj* obj) {
+        subscribe(type, [](void* ctx, const GameEvent& event) { (static_cast<Obj*>(ctx)->*Method)(event); }, obj);
+    }
+
+    bool push(const GameEvent& event); // false if the queue is full
+    void dispatch();
+    void clear() { m_count = 0; }
+    int size() const { return m_count; }
+    const GameEvent& operator[](int i) const { return m_events[i]; }
+    long dropped() const { return m_dropped; }
 
+private:
+    static constexpr int kTypeCount = (int)GameEventType::NEW_LEVEL + 1;
+    struct Subscriber {
+        Handler fn;
+        void* ctx;
+    };
+    GameEvent m_events[kCapacity];
+    int m_count = 0;
+    long m_dropped = 0;
+    std::vector<Subscriber> m_subscribers[kTypeCount]; // filled at setup, only read by dispatch()
+};
 
 
-bool checkCollision(std::shared_ptr<Creature> a, std::shared_ptr<Creature> b);
+
+
+bool checkCollision(const std::shared_ptr<Creature>& a, const std::shared_ptr<Creature>& b);
 
 
 class GameLevel {
@@ -194,19 +330,22 @@ enum class GameSceneKind {
     AQUARIUM_GAME,
     GAME_OVER
 };
+const int kGameSceneKindCount = 3;
 
 string GameSceneKindToString(GameSceneKind t);
 
 class GameIntroScene : public GameScene {
     public:
-        GameIntroScene(string name, std::shared_ptr<GameSprite> banner)
-        : m_name(name), m_banner(std::move(banner)){};
+        // with a loader, draws its progress under the banner until every asset is in
+        GameIntroScene(string name, std::shared_ptr<GameSprite> banner, const AssetLoader* loader = nullptr)
+        : m_name(name), m_banner(std::move(banner)), m_loader(loader){};
         string GetName() override {return this->m_name;}
         void Update() override;
         void Draw() override;
     private:
         string m_name;
         std::shared_ptr<GameSprite> m_banner;
+        const AssetLoader* m_loader;
 };
 
 class GameOverScene : public GameScene {
@@ -222,13 +361,15 @@ class GameOverScene : public GameScene {
 };
 
 
+// Scenes live in a table indexed by GameSceneKind, so lookups are an array index.
 class GameSceneManager {
     public:
-        void Transition(string name);
-        void AddScene(std::shared_ptr<GameScene> newScene);
-        bool HasScenes(){return m_scenes.size() > 0; }
-        std::shared_ptr<GameScene> GetScene(string name);
-        std::shared_ptr<GameScene> GetActiveScene();
+        void Transition(GameSceneKind kind);
+        void AddScene(GameSceneKind kind, std::shared_ptr<GameScene> newScene);
+        bool HasScenes() const { return m_active >= 0; }
+        const std::shared_ptr<GameScene>& GetScene(GameSceneKind kind) const { return m_scenes[(int)kind]; }
+        const std::shared_ptr<GameScene>& GetActiveScene() const { return m_scenes[std::max(0, m_active)]; }
+        bool IsActive(GameSceneKind kind) const { return m_active == (int)kind; }
         
         // support the functionality
         string GetActiveSceneName();
@@ -236,7 +377,7 @@ class GameSceneManager {
         void DrawActiveScene();
 
     private:
-        std::vector<std::shared_ptr<GameScene>> m_scenes;
-        std::shared_ptr<GameScene> m_active_scene;
+        std::shared_ptr<GameScene> m_scenes[kGameSceneKindCount];
+        int m_active = -1; // GameSceneKind, -1 until the first scene is added
 
 };
\ No newline at end of file
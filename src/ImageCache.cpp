@@ -0,0 +1,147 @@
+#include "ImageCache.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kMagic[4] = {'A', 'Q', 'P', 'X'};
+const uint32_t kVersion = 1;
+
+struct EntryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+};
+
+// FNV-1a over the whole source file
+uint64_t hashFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return 0;
+    uint64_t hash = 1469598103934665603ULL;
+    char buf[16 * 1024];
+    while (in) {
+        in.read(buf, sizeof(buf));
+        for (std::streamsize i = 0; i < in.gcount(); ++i) {
+            hash ^= (unsigned char)buf[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+ofImageType imageTypeFor(uint32_t channels) {
+    switch (channels) {
+        case 1:  return OF_IMAGE_GRAYSCALE;
+        case 3:  return OF_IMAGE_COLOR;
+        default: return OF_IMAGE_COLOR_ALPHA;
+    }
+}
+
+bool fromBlob(ofImage& image, const unsigned char* data, size_t size, int width, int height) {
+    if (size < sizeof(EntryHeader)) return false;
+    EntryHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, 4) != 0 || header.version != kVersion) return false;
+    if ((int)header.width != width || (int)header.height != height) return false;
+    if (header.channels != 1 && header.channels != 3 && header.channels != 4) return false;
+    if (size < sizeof(header) + (size_t)width * height * header.channels) return false;
+    image.setFromPixels(data + sizeof(header), width, height, imageTypeFor(header.channels));
+    return true;
+}
+
+} // namespace
+
+int ImageCache::s_hits = 0;
+int ImageCache::s_misses = 0;
+double ImageCache::s_loadMillis = 0.0;
+static std::mutex s_statsMutex; // load() also runs on scene loader threads
+
+bool ImageCache::load(ofImage& image, const std::string& imagePath, int width, int height) {
+    auto start = std::chrono::steady_clock::now();
+    const std::string entry = entryPath(imagePath, width, height);
+    bool ok = true;
+    const bool hit = !entry.empty() && readEntry(image, entry, width, height);
+    if (!hit) {
+        ok = image.load(imagePath);
+        if (ok) {
+            image.resize(width, height);
+            if (!entry.empty()) writeEntry(image, entry);
+        }
+    }
+    std::lock_guard<std::mutex> lock(s_statsMutex);
+    ++(hit ? s_hits : s_misses);
+    s_loadMillis += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+std::string ImageCache::entryPath(const std::string& imagePath, int width, int height) {
+    const uint64_t hash = hashFile(ofToDataPath(imagePath, true));
+    if (hash == 0) return ""; // no source file, let ofImage::load report it
+    std::string name = imagePath;
+    for (char& c : name) {
+        if (c == '/' || c == '\\' || c == '.') c = '_';
+    }
+    char key[64];
+    std::snprintf(key, sizeof(key), "-%016llx-%dx%d.px", (unsigned long long)hash, width, height);
+    return ofToDataPath("cache/" + name + key, true);
+}
+
+bool ImageCache::readEntry(ofImage& image, const std::string& entry, int width, int height) {
+#ifndef _WIN32
+    int fd = ::open(entry.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    bool ok = false;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* mapped = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            ok = fromBlob(image, static_cast<const unsigned char*>(mapped), (size_t)st.st_size, width, height);
+            ::munmap(mapped, (size_t)st.st_size);
+        }
+    }
+    ::close(fd);
+    return ok;
+#else
+    std::ifstream in(entry, std::ios::binary);
+    if (!in) return false;
+    std::vector<unsigned char> blob((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return fromBlob(image, blob.data(), blob.size(), width, height);
+#endif
+}
+
+void ImageCache::writeEntry(const ofImage& image, const std::string& entry) {
+    const ofPixels& pixels = image.getPixels();
+    EntryHeader header;
+    std::memcpy(header.magic, kMagic, 4);
+    header.version = kVersion;
+    header.width = (uint32_t)pixels.getWidth();
+    header.height = (uint32_t)pixels.getHeight();
+    header.channels = (uint32_t)pixels.getNumChannels();
+
+    ofDirectory::createDirectory("cache", true, true);
+    // write next to the entry and rename, so a crash never leaves half an entry behind
+    const std::string tmp = entry + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(pixels.getData()), pixels.getTotalBytes());
+        if (!out) return;
+    }
+    std::remove(entry.c_str());
+    std::rename(tmp.c_str(), entry.c_str());
+}
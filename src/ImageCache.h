@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include "ofMain.h"
+
+// On-disk cache of the game's images, already resized to the size they are drawn at.
+// Entries live in data/cache/ as raw pixel blobs keyed by a hash of the source file and
+// the target size, so later runs skip the PNG decode and the resize and just map the
+// blob into memory. Editing an image changes its hash, which makes a fresh entry.
+// load() may be called from several threads at once, each with its own image.
+class ImageCache {
+public:
+    // same result as image.load(imagePath) followed by image.resize(width, height)
+    static bool load(ofImage& image, const std::string& imagePath, int width, int height);
+
+    // hits, misses and time spent in load(), for the startup timing report
+    static int hits() { return s_hits; }
+    static int misses() { return s_misses; }
+    static double loadMillis() { return s_loadMillis; }
+
+private:
+    static std::string entryPath(const std::string& imagePath, int width, int height);
+    static bool readEntry(ofImage& image, const std::string& entry, int width, int height);
+    static void writeEntry(const ofImage& image, const std::string& entry);
+
+    static int s_hits;
+    static int s_misses;
+    static double s_loadMillis;
+};
@@ -0,0 +1,111 @@
+#include "Log.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+struct Line {
+    ofLogLevel level;
+    int length;
+    char text[Log::kMaxLineLength];
+};
+
+// The ring and the thread that empties it. The lock is only held to copy a line in or
+// out, never while ofLog writes.
+class Writer {
+public:
+    Writer() : m_thread([this] { run(); }) {}
+    ~Writer() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_wake.notify_one();
+        m_thread.join(); // drains what is left first
+    }
+
+    void push(ofLogLevel level, const char* text, size_t length) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_count == Log::kCapacity) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            Line& line = m_lines[(m_head + m_count) % Log::kCapacity];
+            line.level = level;
+            line.length = (int)std::min(length, (size_t)Log::kMaxLineLength);
+            memcpy(line.text, text, line.length);
+            ++m_count;
+        }
+        m_wake.notify_one();
+    }
+
+    void flush() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_count == 0 && !m_writing; });
+    }
+
+    long dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    void run() {
+        Line line;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [this] { return m_count > 0 || m_quit; });
+            if (m_count == 0) return; // quitting and drained
+            line = m_lines[m_head];
+            m_head = (m_head + 1) % Log::kCapacity;
+            --m_count;
+            m_writing = true;
+            lock.unlock();
+            ofLog(line.level, std::string(line.text, line.length));
+            lock.lock();
+            m_writing = false;
+            if (m_count == 0) m_idle.notify_all();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    Line m_lines[Log::kCapacity];
+    int m_head = 0;
+    int m_count = 0;
+    bool m_writing = false;
+    bool m_quit = false;
+    std::atomic<long> m_dropped{0};
+    std::thread m_thread; // last, so it starts after the rest is set up
+};
+
+Writer& writer() {
+    static Writer w; // started by the first line, joined at exit
+    return w;
+}
+
+} // namespace
+
+void Log::push(ofLogLevel level, const char* text, size_t length) {
+    writer().push(level, text, length);
+}
+
+void Log::flush() {
+    writer().flush();
+}
+
+long Log::dropped() {
+    return writer().dropped();
+}
+
+LogMessage::LogMessage(ofLogLevel level) : m_level(level), m_stream(&m_buffer) {}
+
+LogMessage::~LogMessage() {
+    const char* text = m_buffer.data();
+    size_t length = m_buffer.size();
+    while (length > 0 && text[length - 1] == '\n') --length; // ofLog ends the line itself
+    Log::push(m_level, text, length);
+}
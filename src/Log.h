@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ofMain.h"
+#include <ostream>
+#include <streambuf>
+
+// Game logging. AQ_LOG_NOTICE() << "..." works like ofLogNotice() << "...", except that
+//  - levels below AQUARIUM_LOG_LEVEL are compiled out: the condition is a constant, so the
+//    stream expression is never evaluated and the optimizer drops it,
+//  - levels below ofGetLogLevel() skip the formatting at runtime instead of throwing it away,
+//  - the line is formatted into a fixed buffer in the LogMessage itself, so it does not
+//    allocate, and a line logged while another is being streamed comes out on its own,
+//  - the finished line goes into a ring buffer that a background thread hands to ofLog, so
+//    the frame never waits on the console. When the ring is full the line is dropped.
+//
+// AQUARIUM_LOG_LEVEL counts like ofLogLevel (0 verbose, 1 notice, 2 warning, 3 error).
+// Release builds keep notice and up, debug builds everything; set it with
+// PROJECT_DEFINES = AQUARIUM_LOG_LEVEL=2 in config.make to override.
+#ifndef AQUARIUM_LOG_LEVEL
+#ifdef NDEBUG
+#define AQUARIUM_LOG_LEVEL 1
+#else
+#define AQUARIUM_LOG_LEVEL 0
+#endif
+#endif
+
+class Log {
+public:
+    static constexpr int kCapacity = 256;   // lines waiting for the writer thread
+    static constexpr int kMaxLineLength = 240; // longer lines are cut
+
+    // copies the line into the ring, never blocks on I/O
+    static void push(ofLogLevel level, const char* text, size_t length);
+    // waits until every queued line has been handed to ofLog (ofApp::exit, before a crash dump)
+    static void flush();
+    static long dropped(); // lines lost to a full ring so far
+};
+
+// A LogMessage's line: its stream writes straight into this fixed array, and whatever
+// comes past kMaxLineLength characters is cut.
+class LogLineBuffer : public std::streambuf {
+public:
+    LogLineBuffer() { setp(m_text, m_text + Log::kMaxLineLength); }
+    const char* data() const { return pbase(); }
+    size_t size() const { return (size_t)(pptr() - pbase()); }
+protected:
+    int_type overflow(int_type c) override { return traits_type::not_eof(c); } // full, drop it
+private:
+    char m_text[Log::kMaxLineLength];
+};
+
+// one log line, queued when it goes out of scope at the end of the statement
+class LogMessage {
+public:
+    explicit LogMessage(ofLogLevel level);
+    ~LogMessage();
+    template <class T>
+    LogMessage& operator<<(const T& value) { m_stream << value; return *this; }
+    LogMessage& operator<<(std::ostream& (*manip)(std::ostream&)) { manip(m_stream); return *this; }
+
+private:
+    ofLogLevel m_level;
+    LogLineBuffer m_buffer;
+    std::ostream m_stream; // after m_buffer, which it writes to
+};
+
+#define AQ_LOG(level) \
+    if (!((int)(level) >= AQUARIUM_LOG_LEVEL && (level) >= ofGetLogLevel())) {} else LogMessage(level)
+#define AQ_LOG_VERBOSE() AQ_LOG(OF_LOG_VERBOSE)
+#define AQ_LOG_NOTICE()  AQ_LOG(OF_LOG_NOTICE)
+#define AQ_LOG_WARNING() AQ_LOG(OF_LOG_WARNING)
+#define AQ_LOG_ERROR()   AQ_LOG(OF_LOG_ERROR)
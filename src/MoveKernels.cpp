@@ -0,0 +1,172 @@
+#include "MoveKernels.h"
+#include "Aquarium.h"
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define AQUARIUM_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF // an fma would round differently from the other kernel sets
+#endif
+
+// Scalar set: the species step functions themselves, which are the reference for the others
+static void scalarStraight(CreatureStore& s, size_t begin, size_t end, float speedScale, float limitW, float limitH) {
+    for (size_t i = begin; i < end; ++i) {
+        s.prevX[i] = s.x[i];
+        s.prevY[i] = s.y[i];
+        FishState fish = s.row(i);
+        NPCreature::moveStraight(fish, speedScale, limitW, limitH);
+    }
+}
+
+static void scalarPuffer(CreatureStore& s, size_t begin, size_t end, float limitW, float limitH) {
+    for (size_t i = begin; i < end; ++i) {
+        s.prevX[i] = s.x[i];
+        s.prevY[i] = s.y[i];
+        FishState fish = s.row(i);
+        PufferFish::step(fish, limitW, limitH);
+    }
+}
+
+static void scalarAngelfish(CreatureStore& s, size_t begin, size_t end, float limitW, float limitH) {
+    for (size_t i = begin; i < end; ++i) {
+        s.prevX[i] = s.x[i];
+        s.prevY[i] = s.y[i];
+        FishState fish = s.row(i);
+        Angelfish::step(fish, limitW, limitH);
+    }
+}
+
+static uint64_t scalarOverlap(float cx, float cy, float r, const float* x, const float* y, const float* radius, size_t count) {
+    uint64_t hits = 0;
+    for (size_t k = 0; k < count; ++k) {
+        const float dx = cx - x[k];
+        const float dy = cy - y[k];
+        const float rr = r + radius[k];
+        if (dx*dx + dy*dy <= rr*rr) hits |= uint64_t(1) << k;
+    }
+    return hits;
+}
+
+static const MoveKernels kScalarKernels{"scalar", scalarStraight, scalarPuffer, scalarAngelfish, scalarOverlap};
+
+
+#ifdef AQUARIUM_X86
+// SSE2 is part of x86-64, so this set needs no special compile flags
+namespace sse2 {
+struct Lanes {
+    static constexpr size_t kLanes = 4;
+    using F = __m128;
+    using I = __m128i;
+    static F load(const float* p) { return _mm_loadu_ps(p); }
+    static F loadInt(const int* p) { return _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+    static void store(float* p, F v) { _mm_storeu_ps(p, v); }
+    static F set1(float v) { return _mm_set1_ps(v); }
+    static F zero() { return _mm_setzero_ps(); }
+    static F add(F a, F b) { return _mm_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static F max(F a, F b) { return _mm_max_ps(a, b); } // b when equal, like std::max(b, a)
+    static F lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+    static F le(F a, F b) { return _mm_cmple_ps(a, b); }
+    static F gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+    static F ge(F a, F b) { return _mm_cmpge_ps(a, b); }
+    static F eq(F a, F b) { return _mm_cmpeq_ps(a, b); }
+    static F orMask(F a, F b) { return _mm_or_ps(a, b); }
+    static F select(F m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+    static F flipSign(F m, F a) { return _mm_xor_ps(a, _mm_and_ps(m, _mm_set1_ps(-0.0f))); }
+    static I truncToInt(F a) { return _mm_cvttps_epi32(a); }
+    static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+    static F oddMask(I k) { return _mm_castsi128_ps(_mm_srai_epi32(_mm_slli_epi32(k, 31), 31)); }
+    static unsigned bits(F m) { return (unsigned)_mm_movemask_ps(m); }
+};
+using V = Lanes;
+#include "MoveKernels.inl"
+}
+static const MoveKernels kSse2Kernels{"sse2", sse2::straight, sse2::puffer, sse2::angelfish, sse2::overlap};
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+namespace avx2 {
+struct Lanes {
+    static constexpr size_t kLanes = 8;
+    using F = __m256;
+    using I = __m256i;
+    static F load(const float* p) { return _mm256_loadu_ps(p); }
+    static F loadInt(const int* p) { return _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))); }
+    static void store(float* p, F v) { _mm256_storeu_ps(p, v); }
+    static F set1(float v) { return _mm256_set1_ps(v); }
+    static F zero() { return _mm256_setzero_ps(); }
+    static F add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F max(F a, F b) { return _mm256_max_ps(a, b); }
+    static F lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static F le(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static F gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static F ge(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static F eq(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static F orMask(F a, F b) { return _mm256_or_ps(a, b); }
+    static F select(F m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+    static F flipSign(F m, F a) { return _mm256_xor_ps(a, _mm256_and_ps(m, _mm256_set1_ps(-0.0f))); }
+    static I truncToInt(F a) { return _mm256_cvttps_epi32(a); }
+    static F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+    static F oddMask(I k) { return _mm256_castsi256_ps(_mm256_srai_epi32(_mm256_slli_epi32(k, 31), 31)); }
+    static unsigned bits(F m) { return (unsigned)_mm256_movemask_ps(m); }
+};
+using V = Lanes;
+#include "MoveKernels.inl"
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+static const MoveKernels kAvx2Kernels{"avx2", avx2::straight, avx2::puffer, avx2::angelfish, avx2::overlap};
+
+static bool cpuHasAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false; // the OS has to save the ymm registers
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // AQUARIUM_X86
+
+
+std::vector<const MoveKernels*> MoveKernels::available() {
+    std::vector<const MoveKernels*> sets;
+#ifdef AQUARIUM_X86
+    if (cpuHasAvx2()) sets.push_back(&kAvx2Kernels);
+    sets.push_back(&kSse2Kernels);
+#endif
+    sets.push_back(&kScalarKernels);
+    return sets;
+}
+
+const MoveKernels& MoveKernels::best() {
+    static const MoveKernels* chosen = available().front();
+    return *chosen;
+}
+
+const MoveKernels* MoveKernels::find(const char* name) {
+    for (const MoveKernels* set : available()) {
+        if (std::string(set->name) == name) return set;
+    }
+    return nullptr;
+}
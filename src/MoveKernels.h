@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+struct CreatureStore;
+
+// Movement kernels that step a whole species range of the CreatureStore at once:
+// integrate, clamp to the bounds and reflect, 8 fish per instruction with AVX2 or 4
+// with SSE2. The set is picked at runtime from what the CPU supports. The scalar set
+// just runs the species' step functions, and the vector sets do exactly the same float
+// operations in the same order (no FMA, same fastSin polynomial), so every set gives
+// bit-identical results and replays do not depend on the machine.
+// The same sets carry the batch circle test the collision code uses.
+struct MoveKernels {
+    using StraightFn = void (*)(CreatureStore& store, size_t begin, size_t end, float speedScale, float limitW, float limitH);
+    using SpeciesFn = void (*)(CreatureStore& store, size_t begin, size_t end, float limitW, float limitH);
+    using OverlapFn = uint64_t (*)(float cx, float cy, float r, const float* x, const float* y, const float* radius, size_t count);
+
+    const char* name;
+    StraightFn straight;  // NPCreature (speedScale 1) and BiggerFish (0.5)
+    SpeciesFn puffer;
+    SpeciesFn angelfish;
+    // bit k is set when circle k of the packed centers/radii overlaps (cx, cy, r); count <= 64
+    OverlapFn overlap;
+
+    static const MoveKernels& best();            // widest set this CPU runs
+    static const MoveKernels* find(const char* name); // "avx2", "sse2" or "scalar", null if unsupported
+    static std::vector<const MoveKernels*> available();
+};
+
+inline int lowestSetBit(uint64_t bits) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int)index;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+// calls visit(k), in order, for every circle k in [0, count) that overlaps (cx, cy, r)
+template <class Visit>
+void forEachCircleOverlap(const MoveKernels& kernels, float cx, float cy, float r,
+                          const float* x, const float* y, const float* radius, size_t count, Visit&& visit) {
+    for (size_t base = 0; base < count; base += 64) {
+        uint64_t hits = kernels.overlap(cx, cy, r, x + base, y + base, radius + base, std::min<size_t>(64, count - base));
+        while (hits != 0) {
+            visit(base + lowestSetBit(hits));
+            hits &= hits - 1;
+        }
+    }
+}
+
+// sin() for the fish wobble: range reduced to [-pi/2, pi/2] and a degree 9 polynomial,
+// within 1e-5 of std::sin for |x| < 200. The vector kernels evaluate the same steps lane
+// by lane. Builds pass -ffp-contract=off so no compiler fuses them into an fma.
+inline float fastSin(float x) {
+    const float t = x * 0.318309886f; // x / pi
+    const int k = (int)(t + (t >= 0.0f ? 0.5f : -0.5f));
+    const float kf = (float)k;
+    float r = x - kf * 3.14159274f;   // pi split in two floats so r stays accurate
+    r = r - kf * -8.74227766e-8f;
+    const float r2 = r * r;
+    float p = 2.7525562e-6f;
+    p = -1.9840874e-4f + r2 * p;
+    p = 8.3333310e-3f + r2 * p;
+    p = -1.6666667e-1f + r2 * p;
+    const float s = r + (r * r2) * p;
+    return (k & 1) ? -s : s;
+}
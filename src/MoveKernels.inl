@@ -0,0 +1,143 @@
+// Vector bodies of the MoveKernels. MoveKernels.cpp includes this once per instruction
+// set, inside a namespace that defines V (the lane type) and compiles it for that target.
+// Every expression mirrors the scalar step functions in Aquarium.cpp operation for
+// operation; keep them in sync.
+
+using F = V::F;
+
+static inline F vsin(F x) {
+    const F t = V::mul(x, V::set1(0.318309886f));
+    const F half = V::select(V::ge(t, V::zero()), V::set1(0.5f), V::set1(-0.5f));
+    const V::I k = V::truncToInt(V::add(t, half));
+    const F kf = V::toFloat(k);
+    F r = V::sub(x, V::mul(kf, V::set1(3.14159274f)));
+    r = V::sub(r, V::mul(kf, V::set1(-8.74227766e-8f)));
+    const F r2 = V::mul(r, r);
+    F p = V::set1(2.7525562e-6f);
+    p = V::add(V::set1(-1.9840874e-4f), V::mul(r2, p));
+    p = V::add(V::set1(8.3333310e-3f), V::mul(r2, p));
+    p = V::add(V::set1(-1.6666667e-1f), V::mul(r2, p));
+    const F s = V::add(r, V::mul(V::mul(r, r2), p));
+    return V::flipSign(V::oddMask(k), s);
+}
+
+// bounceInBounds() for a group of fish
+static inline void bounce(F& x, F& y, F& dx, F& dy, F radius, float limitW, float limitH) {
+    const F zero = V::zero();
+    const F size = V::select(V::gt(radius, zero), V::mul(radius, V::set1(2.0f)), V::set1(20.0f));
+    const F maxX = V::max(V::sub(V::set1(limitW), size), zero);
+    const F maxY = V::max(V::sub(V::set1(limitH), size), zero);
+
+    const F left = V::lt(x, zero);
+    const F right = V::gt(x, maxX);
+    x = V::select(left, zero, V::select(right, maxX, x));
+    dx = V::flipSign(V::orMask(left, right), dx);
+
+    const F top = V::lt(y, zero);
+    const F bottom = V::gt(y, maxY);
+    y = V::select(top, zero, V::select(bottom, maxY, y));
+    dy = V::flipSign(V::orMask(top, bottom), dy);
+}
+
+// dx*dx + dy*dy <= rr*rr against a whole group of circles, one mask bit per lane
+static uint64_t overlap(float cx, float cy, float r, const float* x, const float* y, const float* radius, size_t count) {
+    const F px = V::set1(cx), py = V::set1(cy), pr = V::set1(r);
+    uint64_t hits = 0;
+    size_t k = 0;
+    for (; k + V::kLanes <= count; k += V::kLanes) {
+        const F dx = V::sub(px, V::load(x + k));
+        const F dy = V::sub(py, V::load(y + k));
+        const F rr = V::add(pr, V::load(radius + k));
+        const F hit = V::le(V::add(V::mul(dx, dx), V::mul(dy, dy)), V::mul(rr, rr));
+        hits |= (uint64_t)V::bits(hit) << k;
+    }
+    if (k < count) hits |= scalarOverlap(cx, cy, r, x + k, y + k, radius + k, count - k) << k;
+    return hits;
+}
+
+static void straight(CreatureStore& s, size_t begin, size_t end, float speedScale, float limitW, float limitH) {
+    size_t i = begin;
+    for (; i + V::kLanes <= end; i += V::kLanes) {
+        F x = V::load(&s.x[i]), y = V::load(&s.y[i]);
+        F dx = V::load(&s.dx[i]), dy = V::load(&s.dy[i]);
+        V::store(&s.prevX[i], x);
+        V::store(&s.prevY[i], y);
+        const F speed = V::mul(V::loadInt(&s.speed[i]), V::set1(speedScale));
+        x = V::add(x, V::mul(dx, speed));
+        y = V::add(y, V::mul(dy, speed));
+        bounce(x, y, dx, dy, V::load(&s.radius[i]), limitW, limitH);
+        V::store(&s.x[i], x);
+        V::store(&s.y[i], y);
+        V::store(&s.dx[i], dx);
+        V::store(&s.dy[i], dy);
+    }
+    scalarStraight(s, i, end, speedScale, limitW, limitH);
+}
+
+static void puffer(CreatureStore& s, size_t begin, size_t end, float limitW, float limitH) {
+    // the tick/radius bookkeeping is integer work, the vector loop reads the result
+    for (size_t i = begin; i < end; ++i) {
+        FishState fish = s.row(i);
+        PufferFish::inflate(fish);
+    }
+    size_t i = begin;
+    for (; i + V::kLanes <= end; i += V::kLanes) {
+        F x = V::load(&s.x[i]), y = V::load(&s.y[i]);
+        F dx = V::load(&s.dx[i]), dy = V::load(&s.dy[i]);
+        V::store(&s.prevX[i], x);
+        V::store(&s.prevY[i], y);
+        const F radius = V::load(&s.radius[i]);
+        const F factor = V::select(V::eq(radius, V::set1((float)PufferFish::inflatedRadius())), V::set1(0.55f), V::set1(1.0f));
+        const F wobble = V::mul(vsin(V::mul(V::set1(0.06f * kFishStepScale), V::loadInt(&s.tick[i]))), V::set1(0.35f));
+        const F speed = V::mul(V::loadInt(&s.speed[i]), factor);
+        const F step = V::set1(kFishStepScale);
+        x = V::add(x, V::mul(V::add(V::mul(dx, speed), wobble), step));
+        y = V::add(y, V::mul(V::sub(V::mul(dy, speed), V::mul(wobble, V::set1(0.6f))), step));
+        bounce(x, y, dx, dy, radius, limitW, limitH);
+        V::store(&s.x[i], x);
+        V::store(&s.y[i], y);
+        V::store(&s.dx[i], dx);
+        V::store(&s.dy[i], dy);
+    }
+    for (; i < end; ++i) {
+        s.prevX[i] = s.x[i];
+        s.prevY[i] = s.y[i];
+        FishState fish = s.row(i);
+        PufferFish::swim(fish, limitW, limitH);
+    }
+    // turning draws random numbers and rarely happens, leave it scalar
+    for (size_t j = begin; j < end; ++j) {
+        FishState fish = s.row(j);
+        PufferFish::turnAtEdge(fish, limitW, limitH);
+    }
+}
+
+static void angelfish(CreatureStore& s, size_t begin, size_t end, float limitW, float limitH) {
+    size_t i = begin;
+    for (; i + V::kLanes <= end; i += V::kLanes) {
+        F x = V::load(&s.x[i]), y = V::load(&s.y[i]);
+        F dx = V::load(&s.dx[i]), dy = V::load(&s.dy[i]);
+        V::store(&s.prevX[i], x);
+        V::store(&s.prevY[i], y);
+        const F radius = V::load(&s.radius[i]);
+        const F speed = V::loadInt(&s.speed[i]);
+        F phase = V::add(V::load(&s.phase[i]), V::set1(0.05f * kFishStepScale));
+        const F vy = V::add(V::mul(dy, V::set1(Angelfish::kDrift)), V::mul(vsin(phase), V::set1(0.6f)));
+
+        x = V::add(x, V::mul(V::mul(dx, speed), V::set1(0.8f * kFishStepScale)));
+        y = V::add(y, V::mul(vy, V::mul(speed, V::set1(0.9f * kFishStepScale))));
+        bounce(x, y, dx, dy, radius, limitW, limitH);
+
+        const F zero = V::zero();
+        const F diameter = V::mul(radius, V::set1(2.0f));
+        const F edgeY = V::orMask(V::le(y, zero), V::ge(V::add(y, diameter), V::set1(limitH)));
+        phase = V::select(edgeY, V::add(phase, V::set1(3.14159f)), phase);
+
+        V::store(&s.x[i], x);
+        V::store(&s.y[i], y);
+        V::store(&s.dx[i], dx);
+        V::store(&s.dy[i], dy);
+        V::store(&s.phase[i], phase);
+    }
+    scalarAngelfish(s, i, end, limitW, limitH);
+}
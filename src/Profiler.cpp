@@ -0,0 +1,103 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+bool Profiler::s_enabled = true;
+int Profiler::s_depth = 0;
+std::vector<Profiler::Frame> Profiler::s_frames;
+int Profiler::s_current = 0;
+int Profiler::s_finished = 0;
+std::vector<Profiler::ZoneSummary> Profiler::s_summary;
+
+uint64_t Profiler::nowNanos() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::beginFrame() {
+    const uint64_t now = nowNanos();
+    if (s_frames.empty()) {
+        s_frames.resize(kRingFrames); // the only allocation, on the first frame
+    } else {
+        s_frames[s_current].end = now;
+        s_finished = std::min(s_finished + 1, kHistoryFrames);
+        s_current = (s_current + 1) % kRingFrames;
+    }
+    Frame& frame = s_frames[s_current];
+    frame.start = now;
+    frame.end = 0;
+    frame.zoneCount = 0;
+}
+
+void Profiler::record(const char* name, uint64_t startNanos, uint64_t endNanos, int depth) {
+    if (s_frames.empty()) return; // before the first beginFrame()
+    Frame& frame = s_frames[s_current];
+    if (frame.zoneCount == kMaxZonesPerFrame) return;
+    frame.zones[frame.zoneCount++] = Zone{name, startNanos, endNanos, depth};
+}
+
+const std::vector<Profiler::ZoneSummary>& Profiler::summarize(int frames) {
+    s_summary.clear();
+    const int count = std::min(frames, s_finished);
+    if (count <= 0) return s_summary;
+
+    static std::vector<double> frameMillis; // this frame's total per summary entry
+    s_summary.push_back(ZoneSummary{"frame", 0.0, 0.0, 1.0, 0});
+    for (int k = 1; k <= count; ++k) {
+        const Frame& frame = s_frames[(s_current - k + kRingFrames) % kRingFrames];
+        frameMillis.assign(s_summary.size(), 0.0);
+        frameMillis[0] = (frame.end - frame.start) / 1e6;
+        for (int z = 0; z < frame.zoneCount; ++z) {
+            const Zone& zone = frame.zones[z];
+            size_t i = 1;
+            while (i < s_summary.size() && strcmp(s_summary[i].name, zone.name) != 0) ++i;
+            if (i == s_summary.size()) {
+                s_summary.push_back(ZoneSummary{zone.name, 0.0, 0.0, 0.0, zone.depth + 1});
+                frameMillis.push_back(0.0);
+            }
+            frameMillis[i] += (zone.end - zone.start) / 1e6;
+            s_summary[i].calls += 1.0;
+        }
+        for (size_t i = 0; i < s_summary.size(); ++i) {
+            s_summary[i].avgMillis += frameMillis[i];
+            s_summary[i].maxMillis = std::max(s_summary[i].maxMillis, frameMillis[i]);
+        }
+    }
+    for (ZoneSummary& zone : s_summary) {
+        zone.avgMillis /= count;
+        zone.calls /= count;
+    }
+    s_summary[0].calls = 1.0;
+    std::sort(s_summary.begin() + 1, s_summary.end(),
+              [](const ZoneSummary& a, const ZoneSummary& b) { return a.avgMillis > b.avgMillis; });
+    return s_summary;
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+    if (s_finished == 0) return false;
+    FILE* out = fopen(path.c_str(), "w");
+    if (out == nullptr) return false;
+
+    // oldest finished frame first, timestamps in microseconds from its start
+    const int first = (s_current - s_finished + kRingFrames) % kRingFrames;
+    const uint64_t origin = s_frames[first].start;
+    auto event = [&](const char* name, uint64_t start, uint64_t end, bool comma) {
+        fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                comma ? ",\n" : "", name, (start - origin) / 1e3, (end - start) / 1e3);
+    };
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool comma = false;
+    for (int k = 0; k < s_finished; ++k) {
+        const Frame& frame = s_frames[(first + k) % kRingFrames];
+        event("frame", frame.start, frame.end, comma);
+        comma = true;
+        for (int z = 0; z < frame.zoneCount; ++z) {
+            event(frame.zones[z].name, frame.zones[z].start, frame.zones[z].end, true);
+        }
+    }
+    fprintf(out, "\n]}\n");
+    return fclose(out) == 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Frame profiler. PROFILE_ZONE("name") times the rest of the enclosing scope; the zones
+// of the last kHistoryFrames frames are kept in a fixed ring, so recording costs two clock
+// reads and never allocates. The HUD overlay shows averages over the last frames and
+// writeChromeTrace() dumps the whole ring for chrome://tracing or https://ui.perfetto.dev.
+// Zones are only recorded on the main thread (the one that calls beginFrame()).
+class Profiler {
+public:
+    static constexpr int kHistoryFrames = 300;   // 5 seconds at 60 fps
+    static constexpr int kMaxZonesPerFrame = 64; // later zones in a frame are dropped
+
+    struct ZoneSummary {
+        const char* name;
+        double avgMillis; // per frame, over the frames summarized
+        double maxMillis; // worst single frame
+        double calls;     // per frame
+        int depth;        // nesting of its first call, 0 for the frame
+    };
+
+    static void setEnabled(bool on) { s_enabled = on; }
+    static bool isEnabled() { return s_enabled; }
+
+    // closes the current frame and starts the next one, once per ofApp::update
+    static void beginFrame();
+    static uint64_t nowNanos();
+    static void record(const char* name, uint64_t startNanos, uint64_t endNanos, int depth);
+
+    // totals per zone over the last `frames` finished frames, slowest first; the first entry
+    // is the whole frame. The vector is reused by the next call.
+    static const std::vector<ZoneSummary>& summarize(int frames);
+    // the finished frames in the ring as Chrome trace_event JSON
+    static bool writeChromeTrace(const std::string& path);
+
+    static int s_depth; // zones open right now, for nesting in the overlay and the trace
+
+private:
+    struct Zone {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+        int depth;
+    };
+    struct Frame {
+        uint64_t start = 0;
+        uint64_t end = 0;
+        int zoneCount = 0;
+        Zone zones[kMaxZonesPerFrame];
+    };
+
+    static bool s_enabled;
+    // kHistoryFrames finished frames plus the one being recorded
+    static constexpr int kRingFrames = kHistoryFrames + 1;
+    static std::vector<Frame> s_frames; // ring of kRingFrames
+    static int s_current;               // frame being recorded
+    static int s_finished;              // finished frames in the ring, up to kHistoryFrames
+    static std::vector<ZoneSummary> s_summary;
+};
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : m_name(name) {
+        if (Profiler::isEnabled()) {
+            m_depth = Profiler::s_depth++;
+            m_start = Profiler::nowNanos();
+        }
+    }
+    ~ProfileZone() {
+        if (m_depth >= 0) {
+            Profiler::record(m_name, m_start, Profiler::nowNanos(), m_depth);
+            --Profiler::s_depth;
+        }
+    }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_start = 0;
+    int m_depth = -1; // -1 when the profiler was off at construction
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(name)
@@ -0,0 +1,35 @@
+#include "Random.h"
+
+uint64_t GameRandom::s_seed = 1;
+uint32_t GameRandom::s_lastCreatureId = 0;
+
+static inline uint64_t splitmix(uint64_t z) {
+    z += 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+void GameRandom::seed(uint64_t seed) {
+    s_seed = seed;
+    s_lastCreatureId = 0;
+}
+
+uint64_t GameRandom::bits(uint64_t key, uint64_t counter) {
+    return splitmix(splitmix(s_seed ^ (key * 0xD1B54A32D192ED03ull)) + counter);
+}
+
+void GameRandom::fill(uint64_t key, uint64_t counter, uint32_t* out, size_t n) {
+    // the key half only needs mixing once for the whole batch
+    const uint64_t base = splitmix(s_seed ^ (key * 0xD1B54A32D192ED03ull));
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = (uint32_t)(splitmix(base + counter + i) >> 32);
+    }
+}
+
+void GameRandom::fillUniform(uint64_t key, uint64_t counter, float* out, size_t n) {
+    const uint64_t base = splitmix(s_seed ^ (key * 0xD1B54A32D192ED03ull));
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = (splitmix(base + counter + i) >> 40) * (1.0f / 16777216.0f);
+    }
+}
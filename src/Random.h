@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Counter-based random numbers for everything gameplay related. A value is a pure
+// function of (seed, key, counter), with no hidden state advanced by each call the way
+// rand() works, so a fish's numbers only depend on its own id and tick. Results are
+// reproducible from the seed and do not change with update order or thread count.
+// The mixing is the SplitMix64 finalizer, applied twice.
+class GameRandom {
+public:
+    // also restarts creature ids, so the same seed replays the same game
+    static void seed(uint64_t seed);
+    static uint64_t getSeed() { return s_seed; }
+
+    // ids key each creature's stream; handed out in spawn order
+    static uint32_t nextCreatureId() { return ++s_lastCreatureId; }
+    static uint32_t lastCreatureId() { return s_lastCreatureId; }
+    static void setLastCreatureId(uint32_t id) { s_lastCreatureId = id; }
+
+    static uint64_t bits(uint64_t key, uint64_t counter);
+    // in [0, n), n > 0
+    static int below(int n, uint64_t key, uint64_t counter) { return (int)(bits(key, counter) % (uint64_t)n); }
+    // in [0, 1)
+    static float uniform(uint64_t key, uint64_t counter) { return (bits(key, counter) >> 40) * (1.0f / 16777216.0f); }
+
+    // batch versions: out[i] is bits(key, counter + i) >> 32, or uniform(key, counter + i)
+    static void fill(uint64_t key, uint64_t counter, uint32_t* out, size_t n);
+    static void fillUniform(uint64_t key, uint64_t counter, float* out, size_t n);
+
+    // keys for the streams that do not belong to a creature (creature ids stay below 2^32)
+    static constexpr uint64_t kSpawnKey = (1ull << 32) + 1;
+    static constexpr uint64_t kPowerUpKey = (1ull << 32) + 2;
+
+private:
+    static uint64_t s_seed;
+    static uint32_t s_lastCreatureId;
+};
+
+// Consecutive draws for one key at one tick, for code that needs several numbers at once
+// (e.g. a do/while that retries until a direction is not (0, 0)).
+class RandomStream {
+public:
+    RandomStream(uint64_t key, uint64_t tick) : m_key(key), m_counter(tick << 16) {}
+    int below(int n) { return GameRandom::below(n, m_key, m_counter++); }
+    float uniform() { return GameRandom::uniform(m_key, m_counter++); }
+
+private:
+    uint64_t m_key;
+    uint64_t m_counter;
+};
@@ -0,0 +1,178 @@
+#include "Replay.h"
+#include "Aquarium.h"
+#include <cstring>
+#include <fstream>
+
+static const char kMagic[4] = {'A', 'Q', 'R', 'P'};
+
+static void putFixed(std::vector<uint8_t>& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+static uint64_t zigzag(int v) { return ((uint64_t)(uint32_t)v << 1) ^ (uint64_t)(int64_t)(v >> 31); }
+static int unzigzag(uint64_t v) { return (int)((uint32_t)(v >> 1) ^ (uint32_t)-(int64_t)(v & 1)); }
+
+void InputRecorder::begin(uint64_t seed, int width, int height, uint64_t settingsHash) {
+    m_bytes.clear();
+    for (char c : kMagic) m_bytes.push_back((uint8_t)c);
+    putFixed(m_bytes, Replay::kVersion, 4);
+    putFixed(m_bytes, seed, 8);
+    putFixed(m_bytes, (uint32_t)width, 4);
+    putFixed(m_bytes, (uint32_t)height, 4);
+    putFixed(m_bytes, settingsHash, 8);
+    m_lastTick = 0;
+    m_recording = true;
+}
+
+void InputRecorder::putVarint(uint64_t v) {
+    while (v >= 0x80) {
+        m_bytes.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    m_bytes.push_back((uint8_t)v);
+}
+
+void InputRecorder::record(ReplayEventType type, uint64_t tick) {
+    m_bytes.push_back((uint8_t)type);
+    putVarint(tick - m_lastTick);
+    m_lastTick = tick;
+}
+
+void InputRecorder::keyPressed(uint64_t tick, int key) {
+    if (!m_recording) return;
+    record(ReplayEventType::KEY_PRESSED, tick);
+    putVarint(zigzag(key));
+}
+
+void InputRecorder::keyReleased(uint64_t tick, int key) {
+    if (!m_recording) return;
+    record(ReplayEventType::KEY_RELEASED, tick);
+    putVarint(zigzag(key));
+}
+
+void InputRecorder::resized(uint64_t tick, int width, int height) {
+    if (!m_recording) return;
+    record(ReplayEventType::RESIZE, tick);
+    putVarint((uint32_t)width);
+    putVarint((uint32_t)height);
+}
+
+bool InputRecorder::finish(uint64_t tick, uint64_t stateHash, const std::string& path) {
+    if (!m_recording) return false;
+    m_recording = false;
+    record(ReplayEventType::END, tick);
+    putFixed(m_bytes, stateHash, 8);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char*>(m_bytes.data()), m_bytes.size());
+    return (bool)out;
+}
+
+
+namespace {
+struct Reader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    uint64_t fixed(int bytes) {
+        if (end - p < bytes) { ok = false; return 0; }
+        uint64_t v = 0;
+        for (int i = 0; i < bytes; ++i) v |= (uint64_t)*p++ << (8 * i);
+        return v;
+    }
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p == end) break;
+            uint8_t byte = *p++;
+            v |= (uint64_t)(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+};
+}
+
+bool Replay::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (bytes.size() < 4 || std::memcmp(bytes.data(), kMagic, 4) != 0) return false;
+
+    Reader r{bytes.data() + 4, bytes.data() + bytes.size()};
+    if (r.fixed(4) != kVersion) return false;
+    seed = r.fixed(8);
+    width = (int)(uint32_t)r.fixed(4);
+    height = (int)(uint32_t)r.fixed(4);
+    settingsHash = r.fixed(8);
+    events.clear();
+
+    uint64_t tick = 0;
+    while (r.ok && r.p < r.end) {
+        ReplayEvent event;
+        event.type = (ReplayEventType)*r.p++;
+        tick += r.varint();
+        event.tick = tick;
+        switch (event.type) {
+            case ReplayEventType::KEY_PRESSED:
+            case ReplayEventType::KEY_RELEASED:
+                event.a = unzigzag(r.varint());
+                break;
+            case ReplayEventType::RESIZE:
+                event.a = (int)r.varint();
+                event.b = (int)r.varint();
+                break;
+            case ReplayEventType::END:
+                endTick = tick;
+                stateHash = r.fixed(8);
+                events.push_back(event);
+                return r.ok;
+            default:
+                return false;
+        }
+        events.push_back(event);
+    }
+    return false; // no END record, the game did not shut down cleanly
+}
+
+
+static void fnv(uint64_t& h, const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+}
+
+uint64_t hashGameState(const Aquarium& aquarium, const PlayerCreature& player) {
+    uint64_t h = 1469598103934665603ull;
+    CreatureStore scratch;
+    aquarium.getSyncedStore(scratch).forEachColumn([&h](const auto& column) {
+        fnv(h, column.data(), column.size() * sizeof(column[0]));
+    });
+    for (const PowerUpItem& p : aquarium.getPowerUps()) {
+        fnv(h, &p.x, sizeof(p.x));
+        fnv(h, &p.y, sizeof(p.y));
+    }
+    const float playerState[] = {player.getX(), player.getY(), player.getDx(), player.getDy()};
+    const int playerStats[] = {player.getScore(), player.getLives(), player.getPower(), player.getSpeed()};
+    fnv(h, playerState, sizeof(playerState));
+    fnv(h, playerStats, sizeof(playerStats));
+    return h;
+}
+
+uint64_t hashAquariumSettings(const AquariumSettings& settings) {
+    uint64_t h = 1469598103934665603ull;
+    fnv(h, &settings.playerSpeed, sizeof(settings.playerSpeed));
+    for (const auto& level : settings.levels) {
+        int values[2 + kCreatureTypeCount] = {level->getLevelNumber(), level->getTargetScore()};
+        for (int t = 0; t < kCreatureTypeCount; ++t) {
+            values[2 + t] = level->getPopulation(static_cast<AquariumCreatureType>(t));
+        }
+        fnv(h, values, sizeof(values));
+    }
+    return h;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Aquarium;
+class PlayerCreature;
+struct AquariumSettings;
+
+// Input recording for the aquarium game. The simulation only depends on the GameRandom
+// seed, the window size, the settings (levels and player speed) and the keys pressed
+// between AquariumGameScene::Step() calls, so that is all a replay stores. The settings
+// are only stored as a hash; playback needs the same settings.xml and refuses others.
+// Every GameRandom value is keyed by a tick counter, so the seed in the header stands
+// for the seed of every tick. Files are small enough to attach to a bug report, and the
+// headless runner plays them back (--replay) faster than real time, checking the final
+// state hash.
+//
+// Layout (little endian): "AQRP", u32 version, u64 seed, i32 width, i32 height, u64
+// settings hash, then one record per event: u8 type, varint ticks since the previous
+// record, and the payload (zigzag varint key, varint w/h for resizes, u64 state hash
+// for END).
+enum class ReplayEventType : uint8_t {
+    KEY_PRESSED = 1,
+    KEY_RELEASED = 2,
+    RESIZE = 3,
+    END = 4,
+};
+
+struct ReplayEvent {
+    ReplayEventType type;
+    uint64_t tick; // applied before Step() number tick + 1
+    int a = 0;     // key, or width
+    int b = 0;     // height
+};
+
+class InputRecorder {
+public:
+    void begin(uint64_t seed, int width, int height, uint64_t settingsHash);
+    bool isRecording() const { return m_recording; }
+
+    void keyPressed(uint64_t tick, int key);
+    void keyReleased(uint64_t tick, int key);
+    void resized(uint64_t tick, int width, int height);
+
+    // closes the recording with the final tick and state hash and writes it out
+    bool finish(uint64_t tick, uint64_t stateHash, const std::string& path);
+    // stops without writing, for games that can no longer be replayed from the seed
+    void cancel() { m_recording = false; }
+
+private:
+    void record(ReplayEventType type, uint64_t tick);
+    void putVarint(uint64_t v);
+
+    std::vector<uint8_t> m_bytes;
+    uint64_t m_lastTick = 0;
+    bool m_recording = false;
+};
+
+struct Replay {
+    static constexpr uint32_t kVersion = 4; // bumped whenever the game plays differently
+
+    uint64_t seed = 0;
+    int width = 0;
+    int height = 0;
+    uint64_t settingsHash = 0; // hashAquariumSettings() of the game that was recorded
+    std::vector<ReplayEvent> events; // in tick order, END last
+    uint64_t endTick = 0;
+    uint64_t stateHash = 0;
+
+    bool load(const std::string& path);
+};
+
+// FNV-1a over every store column, the powerups and the player
+uint64_t hashGameState(const Aquarium& aquarium, const PlayerCreature& player);
+// FNV-1a over the player speed and every level's number, target score and population
+uint64_t hashAquariumSettings(const AquariumSettings& settings);
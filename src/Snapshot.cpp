@@ -0,0 +1,336 @@
+#include "Snapshot.h"
+#include "Aquarium.h"
+#include "Random.h"
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kMagic[4] = {'A', 'Q', 'S', 'N'};
+const uint32_t kByteOrderMark = 0x01020304;
+const size_t kAlign = 8; // every section starts on a multiple of this
+
+struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t creatureCount;
+    uint64_t seed;
+    uint64_t tick;
+    uint64_t spawnCount;
+    uint64_t speciesBegin[kCreatureTypeCount];
+    uint32_t lastCreatureId;
+    uint32_t slotCount;
+    uint32_t freeSlotCount;
+    int32_t width;
+    int32_t height;
+    int32_t currentLevel;
+    int32_t levelCount;
+    int32_t powerupCount;
+    int32_t powerupSpawnTimer;
+    int32_t pendingSpawnTotal;
+    int32_t pendingSpawns[kCreatureTypeCount];
+};
+
+struct LevelProgress {
+    int32_t score;
+    int32_t alive[kCreatureTypeCount]; // AquariumLevelPopulationNode::currentPopulation
+};
+
+struct PlayerState {
+    float x, y, dx, dy, prevX, prevY;
+    float width, height, collisionRadius;
+    int32_t speed, baseSpeed, speedCap, speedBoostFrames;
+    int32_t score, lives, power, damageDebounce, value;
+    uint8_t flipped, hasEatenFish;
+};
+
+struct PowerUpState {
+    float x, y, radius;
+    int32_t type;
+};
+
+class Writer {
+public:
+    explicit Writer(std::ofstream& out) : m_out(out) {}
+    void put(const void* data, size_t size) {
+        m_out.write(static_cast<const char*>(data), size);
+        m_offset += size;
+        static const char zeros[kAlign] = {};
+        const size_t pad = (kAlign - m_offset % kAlign) % kAlign;
+        m_out.write(zeros, pad);
+        m_offset += pad;
+    }
+    template <class T>
+    void put(const std::vector<T>& v) { put(v.data(), v.size() * sizeof(T)); }
+
+private:
+    std::ofstream& m_out;
+    size_t m_offset = 0;
+};
+
+struct Reader {
+    const uint8_t* begin;
+    size_t size;
+    size_t offset = 0;
+
+    size_t left() const { return size - offset; }
+    // the next section, or null if the file is too short for it
+    const uint8_t* take(size_t bytes) {
+        if (bytes > size - offset) return nullptr;
+        const uint8_t* p = begin + offset;
+        offset += bytes;
+        offset = std::min(size, (offset + kAlign - 1) / kAlign * kAlign);
+        return p;
+    }
+    template <class T>
+    bool read(T& value) {
+        const uint8_t* p = take(sizeof(T));
+        if (p) std::memcpy(&value, p, sizeof(T));
+        return p != nullptr;
+    }
+    template <class T>
+    bool read(std::vector<T>& v, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "columns are copied as raw bytes");
+        const uint8_t* p = take(count * sizeof(T));
+        if (!p) return false;
+        v.resize(count);
+        if (count > 0) std::memcpy(v.data(), p, count * sizeof(T));
+        return true;
+    }
+};
+
+} // namespace
+
+bool AquariumSnapshot::save(const Aquarium& aquarium, const PlayerCreature& player, const std::string& path) {
+    CreatureStore scratch;
+    const CreatureStore& store = aquarium.getSyncedStore(scratch); // a fish bumped through a view still moves
+    const CreatureSlotMap& slots = aquarium.m_slots;
+
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, kMagic, 4);
+    header.version = kVersion;
+    header.byteOrder = kByteOrderMark;
+    header.creatureCount = (uint32_t)store.size();
+    header.seed = GameRandom::getSeed();
+    header.tick = aquarium.m_tick;
+    header.spawnCount = aquarium.m_spawnCount;
+    for (int t = 0; t < kCreatureTypeCount; ++t) {
+        header.speciesBegin[t] = store.speciesBegin[t];
+        header.pendingSpawns[t] = aquarium.m_pendingSpawns[t];
+    }
+    header.lastCreatureId = GameRandom::lastCreatureId();
+    header.slotCount = (uint32_t)slots.m_row.size();
+    header.freeSlotCount = (uint32_t)slots.m_free.size();
+    header.width = aquarium.m_width;
+    header.height = aquarium.m_height;
+    header.currentLevel = aquarium.currentLevel;
+    header.levelCount = (int32_t)aquarium.m_aquariumlevels.size();
+    header.powerupCount = (int32_t)aquarium.m_powerups.size();
+    header.powerupSpawnTimer = aquarium.m_powerupSpawnTimer;
+    header.pendingSpawnTotal = aquarium.m_pendingSpawnTotal;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    Writer w(out);
+    w.put(&header, sizeof(header));
+
+    for (const auto& level : aquarium.m_aquariumlevels) {
+        LevelProgress progress = {};
+        progress.score = level->m_level_score;
+        for (int t = 0; t < kCreatureTypeCount; ++t) progress.alive[t] = level->m_levelPopulation[t].currentPopulation;
+        w.put(&progress, sizeof(progress));
+    }
+
+    PlayerState p = {};
+    p.x = player.m_x;
+    p.y = player.m_y;
+    p.dx = player.m_dx;
+    p.dy = player.m_dy;
+    p.prevX = player.m_prevX;
+    p.prevY = player.m_prevY;
+    p.width = player.m_width;
+    p.height = player.m_height;
+    p.collisionRadius = player.m_collisionRadius;
+    p.speed = player.m_speed;
+    p.baseSpeed = player.m_baseSpeed;
+    p.speedCap = player.m_speedCap;
+    p.speedBoostFrames = player.m_speedBoostFrames;
+    p.score = player.m_score;
+    p.lives = player.m_lives;
+    p.power = player.m_power;
+    p.damageDebounce = player.m_damage_debounce;
+    p.value = player.m_value;
+    p.flipped = player.m_flipped;
+    p.hasEatenFish = player.m_hasEatenFish;
+    w.put(&p, sizeof(p));
+
+    for (const PowerUpItem& item : aquarium.m_powerups) {
+        const PowerUpState state = {item.x, item.y, item.radius, (int32_t)item.type};
+        w.put(&state, sizeof(state));
+    }
+
+    store.forEachColumn([&w](const auto& column) { w.put(column); });
+    w.put(slots.m_row);
+    w.put(slots.m_generation);
+    w.put(slots.m_free);
+    return (bool)out;
+}
+
+bool AquariumSnapshot::load(Aquarium& aquarium, PlayerCreature& player, const std::string& path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    bool ok = false;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* mapped = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            ok = restore(aquarium, player, static_cast<const uint8_t*>(mapped), (size_t)st.st_size);
+            ::munmap(mapped, (size_t)st.st_size);
+        }
+    }
+    ::close(fd);
+    return ok;
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return restore(aquarium, player, bytes.data(), bytes.size());
+#endif
+}
+
+bool AquariumSnapshot::restore(Aquarium& aquarium, PlayerCreature& player, const uint8_t* data, size_t size) {
+    Reader r{data, size};
+    SnapshotHeader header;
+    if (!r.read(header)) return false;
+    if (std::memcmp(header.magic, kMagic, 4) != 0 || header.version != kVersion) return false;
+    if (header.byteOrder != kByteOrderMark) return false;
+    if (header.levelCount != (int32_t)aquarium.m_aquariumlevels.size()) return false; // other levels
+    if (header.levelCount == 0) return false; // a tank without levels has nothing to play
+    if (header.currentLevel < 0) return false; // taken modulo the level count, so only the sign matters
+    if (header.width <= 0 || header.height <= 0) return false;
+    if (header.powerupCount < 0 || header.powerupCount > Aquarium::kMaxPowerUps) return false;
+    // nothing is sized from the header before the bytes for it are known to be there
+    if ((uint64_t)header.levelCount * sizeof(LevelProgress) + sizeof(PlayerState)
+        + (uint64_t)header.powerupCount * sizeof(PowerUpState) > r.left()) return false;
+    int pendingTotal = 0;
+    for (int t = 0; t < kCreatureTypeCount; ++t) {
+        if (header.pendingSpawns[t] < 0) return false;
+        pendingTotal += header.pendingSpawns[t];
+    }
+    if (pendingTotal != header.pendingSpawnTotal) return false;
+
+    // everything goes into locals first, so a short or broken file changes nothing
+    std::vector<LevelProgress> levels(header.levelCount);
+    for (LevelProgress& progress : levels) {
+        if (!r.read(progress)) return false;
+        for (int t = 0; t < kCreatureTypeCount; ++t) {
+            if (progress.alive[t] < 0) return false;
+        }
+    }
+    PlayerState p;
+    if (!r.read(p)) return false;
+    std::vector<PowerUpItem> powerups(header.powerupCount);
+    for (PowerUpItem& item : powerups) {
+        PowerUpState state;
+        if (!r.read(state)) return false;
+        if (state.type != (int32_t)PowerUpType::SpeedBoost) return false;
+        item.x = state.x;
+        item.y = state.y;
+        item.radius = state.radius;
+        item.type = static_cast<PowerUpType>(state.type);
+        item.sprite = aquarium.m_sprite_manager->GetPowerUpSprite(item.type);
+    }
+
+    const size_t n = header.creatureCount;
+    if (header.speciesBegin[0] != 0) return false;
+    for (int t = 1; t < kCreatureTypeCount; ++t) {
+        if (header.speciesBegin[t] > n || header.speciesBegin[t] < header.speciesBegin[t - 1]) return false;
+    }
+    if (header.freeSlotCount > header.slotCount || header.slotCount < n) return false;
+    CreatureStore store;
+    bool ok = true;
+    store.forEachColumn([&](auto& column) { ok = ok && r.read(column, n); });
+    CreatureSlotMap slots;
+    ok = ok && r.read(slots.m_row, header.slotCount) && r.read(slots.m_generation, header.slotCount)
+            && r.read(slots.m_free, header.freeSlotCount);
+    if (!ok) return false;
+    for (int t = 0; t < kCreatureTypeCount; ++t) store.speciesBegin[t] = (size_t)header.speciesBegin[t];
+
+    // every row sits in its species' range and owns a slot that points back at it,
+    // every other slot is free and listed once in the free list
+    for (size_t i = 0; i < n; ++i) {
+        const int t = static_cast<int>(store.species[i]);
+        if (t < 0 || t >= kCreatureTypeCount) return false;
+        if (i < store.speciesBegin[t] || i >= store.speciesEnd(t)) return false;
+        if (store.slot[i] >= header.slotCount || slots.m_row[store.slot[i]] != (int)i) return false;
+    }
+    size_t used = 0;
+    for (int row : slots.m_row) {
+        if (row < -1 || row >= (int64_t)n) return false;
+        if (row >= 0) ++used;
+    }
+    if (used != n || used + header.freeSlotCount != header.slotCount) return false;
+    for (uint32_t slot : slots.m_free) {
+        if (slot >= header.slotCount || slots.m_row[slot] != -1) return false;
+        slots.m_row[slot] = -2; // seen, catches duplicates
+    }
+    for (uint32_t slot : slots.m_free) slots.m_row[slot] = -1;
+
+    aquarium.clearCreatures(); // drops the old views and their handles
+    aquarium.m_store = std::move(store);
+    aquarium.m_slots = std::move(slots);
+    aquarium.m_creatures.assign(n, nullptr); // made on demand, see Aquarium::viewAt
+    aquarium.m_powerups = std::move(powerups);
+    aquarium.m_powerupSpawnTimer = header.powerupSpawnTimer;
+    aquarium.m_tick = header.tick;
+    aquarium.m_spawnCount = header.spawnCount;
+    aquarium.m_width = header.width;
+    aquarium.m_height = header.height;
+    aquarium.currentLevel = header.currentLevel;
+    for (int t = 0; t < kCreatureTypeCount; ++t) aquarium.m_pendingSpawns[t] = header.pendingSpawns[t];
+    aquarium.m_pendingSpawnTotal = header.pendingSpawnTotal;
+    for (size_t l = 0; l < levels.size(); ++l) {
+        AquariumLevel& level = *aquarium.m_aquariumlevels[l];
+        level.m_level_score = levels[l].score;
+        for (int t = 0; t < kCreatureTypeCount; ++t) level.m_levelPopulation[t].currentPopulation = levels[l].alive[t];
+    }
+    aquarium.m_gridDirty = true;
+    // the whole tank changed, like on a level change
+    aquarium.raise(GameEvent(GameEventType::NEW_LEVEL, CreatureHandle{}, CreatureHandle{},
+                             aquarium.currentLevel % (int)aquarium.m_aquariumlevels.size()));
+
+    GameRandom::seed(header.seed);
+    GameRandom::setLastCreatureId(header.lastCreatureId);
+
+    player.m_x = p.x;
+    player.m_y = p.y;
+    player.m_dx = p.dx;
+    player.m_dy = p.dy;
+    player.m_prevX = p.prevX;
+    player.m_prevY = p.prevY;
+    player.m_width = p.width;
+    player.m_height = p.height;
+    player.m_collisionRadius = p.collisionRadius;
+    player.m_speed = p.speed;
+    player.m_baseSpeed = p.baseSpeed;
+    player.m_speedCap = p.speedCap;
+    player.m_speedBoostFrames = p.speedBoostFrames;
+    player.m_score = p.score;
+    player.m_lives = p.lives;
+    player.m_power = p.power;
+    player.m_damage_debounce = p.damageDebounce;
+    player.m_value = p.value;
+    player.m_flipped = p.flipped != 0;
+    player.m_hasEatenFish = p.hasEatenFish != 0;
+    return true;
+}
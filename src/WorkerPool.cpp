@@ -0,0 +1,63 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(int threads) {
+    for (int i = 1; i < threads; ++i) {
+        m_workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) worker.join();
+}
+
+void WorkerPool::run(size_t count, size_t chunk, ChunkFn fn, void* ctx) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fn = fn;
+        m_ctx = ctx;
+        m_count = count;
+        m_chunk = chunk > 0 ? chunk : 1;
+        m_next.store(0, std::memory_order_relaxed);
+        m_busy = (int)m_workers.size();
+        ++m_job;
+    }
+    m_wake.notify_all();
+
+    drain();
+
+    // every worker has to check in before the next job may overwrite m_fn
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+}
+
+void WorkerPool::workerLoop() {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_quit || m_job != seen; });
+            if (m_quit) return;
+            seen = m_job;
+        }
+        drain();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_busy == 0) m_done.notify_one();
+        }
+    }
+}
+
+void WorkerPool::drain() {
+    for (;;) {
+        size_t begin = m_next.fetch_add(m_chunk, std::memory_order_relaxed);
+        if (begin >= m_count) return;
+        size_t end = std::min(begin + m_chunk, m_count);
+        m_fn(m_ctx, begin, end);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Small pool of worker threads for splitting a loop over many items. parallelFor()
+// hands out fixed-size chunks from a shared atomic counter, so a thread that finishes
+// its chunk early just takes the next one. The calling thread works too and only
+// returns once every chunk is done.
+class WorkerPool {
+public:
+    // threads counts the caller, so 1 (or less) runs everything inline
+    explicit WorkerPool(int threads);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int threadCount() const { return (int)m_workers.size() + 1; }
+
+    // calls fn(begin, end) over [0, count) in chunks of `chunk` items
+    template <class F>
+    void parallelFor(size_t count, size_t chunk, F&& fn) {
+        if (count == 0) return;
+        if (m_workers.empty() || count <= chunk) {
+            fn(size_t(0), count);
+            return;
+        }
+        using Fn = std::remove_reference_t<F>;
+        run(count, chunk, [](void* ctx, size_t begin, size_t end) { (*static_cast<Fn*>(ctx))(begin, end); },
+            (void*)&fn);
+    }
+
+private:
+    using ChunkFn = void (*)(void* ctx, size_t begin, size_t end);
+
+    void run(size_t count, size_t chunk, ChunkFn fn, void* ctx);
+    void workerLoop();
+    void drain();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_job = 0;  // bumped by every run() so sleeping workers know there is work
+    int m_busy = 0;      // workers still inside the current job
+    bool m_quit = false;
+
+    ChunkFn m_fn = nullptr;
+    void* m_ctx = nullptr;
+    size_t m_count = 0;
+    size_t m_chunk = 1;
+    std::atomic<size_t> m_next{0};
+};
@@ -2,20 +2,13 @@
 
 //--------------------------------------------------------------
 void ofApp::setup(){
-    
-
-
-    bgm.load("music/music.mp3");// Load background music
-    bgm.setLoop(true); // Enable looping
-    bgm.setVolume(0.5f);
-    bgm.play(); // Start background music
-
+    uint64_t setupStart = ofGetElapsedTimeMillis();
 
 
     ofSetFrameRate(60);
     ofSetBackgroundColor(ofColor::blue);
-    backgroundImage.load("background.png");
-    backgroundImage.resize(ofGetWindowWidth(), ofGetWindowHeight());
+    WorldBounds::set(ofGetWindowWidth(), ofGetWindowHeight());
+    GameRandom::seed(ofGetSystemTimeMillis()); // a different game every run, the replay keeps the seed
 
 
     std::shared_ptr<Aquarium> myAquarium;
@@ -25,14 +18,26 @@ void ofApp::setup(){
     gameManager = std::make_unique<GameSceneManager>();
 
 
-    // first we make the intro scene 
-    gameManager->AddScene(std::make_shared<GameIntroScene>(
-        GameSceneKindToString(GameSceneKind::GAME_INTRO),
-        std::make_shared<GameSprite>("title.png", ofGetWindowWidth(), ofGetWindowHeight())
+    // first we make the intro scene, its banner is the first thing the loader brings in
+    auto banner = std::make_shared<GameSprite>();
+    assets.addSprite(banner, "title.png", ofGetWindowWidth(), ofGetWindowHeight());
+    assets.addImage(backgroundImage, "background.png", ofGetWindowWidth(), ofGetWindowHeight(), [this] {
+        backgroundReady = true;
+        if (backgroundImage.getWidth() != ofGetWidth() || backgroundImage.getHeight() != ofGetHeight()) {
+            backgroundImage.resize(ofGetWidth(), ofGetHeight()); // the window changed while it loaded
+        }
+    });
+    gameManager->AddScene(GameSceneKind::GAME_INTRO, std::make_shared<GameIntroScene>(
+        GameSceneKindToString(GameSceneKind::GAME_INTRO), std::move(banner), &assets
     ));
 
     //AquariumSpriteManager
-    spriteManager = std::make_shared<AquariumSpriteManager>();
+    spriteManager = std::make_shared<AquariumSpriteManager>(assets);
+
+    // player speed and the levels come from settings.xml
+    AquariumSettings settings = LoadAquariumSettings("settings.xml");
+    DEFAULT_SPEED = settings.playerSpeed;
+    recorder.begin(GameRandom::getSeed(), ofGetWindowWidth(), ofGetWindowHeight(), hashAquariumSettings(settings));
 
     // Lets setup the aquarium
     myAquarium = std::make_shared<Aquarium>(ofGetWindowWidth(), ofGetWindowHeight(), spriteManager);
@@ -42,45 +47,69 @@ void ofApp::setup(){
     player->setBounds(ofGetWindowWidth() - 20, ofGetWindowHeight() - 20);
 
 
-    myAquarium->addAquariumLevel(std::make_shared<Level_0>(0, 10));
-    myAquarium->addAquariumLevel(std::make_shared<Level_1>(1, 15));
-    myAquarium->addAquariumLevel(std::make_shared<Level_2>(2, 20));
-    myAquarium->addAquariumLevel(std::make_shared<Level_3>(3, 25));
-    myAquarium->addAquariumLevel(std::make_shared<Level_4>(4, 30));
-    myAquarium->addAquariumLevel(std::make_shared<Level_5>(5, 35));
+    for (const auto& level : settings.levels) {
+        myAquarium->addAquariumLevel(level);
+    }
 
     myAquarium->Repopulate(); // initial population
 
     // now that we are mostly set, lets pass the player and the aquarium downstream
-    gameManager->AddScene(std::make_shared<AquariumGameScene>(
+    gameManager->AddScene(GameSceneKind::AQUARIUM_GAME, std::make_shared<AquariumGameScene>(
         std::move(player), std::move(myAquarium), GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)
     )); // player and aquarium are owned by the scene moving forward
 
-    // Load font for game over message
-    gameOverTitle.load("Verdana.ttf", 12, true, true);
-    gameOverTitle.setLineHeight(34.0f);
-    gameOverTitle.setLetterSpacing(1.035);
-
-
-    gameManager->AddScene(std::make_shared<GameOverScene>(
-        GameSceneKindToString(GameSceneKind::GAME_OVER),
-        std::make_shared<GameSprite>("game-over.png", ofGetWindowWidth(), ofGetWindowHeight())
+    // music decodes on a loader thread, starts once it is in
+    assets.add([this] { bgm.load("music/music.mp3"); }, [this] {
+        bgm.setLoop(true); // Enable looping
+        bgm.setVolume(musicOn ? 0.5f : 0.0f);
+        bgm.play(); // Start background music
+        musicReady = true;
+    });
+
+    // Load font for game over message (builds its texture, so all of it runs on this thread)
+    assets.add({}, [this] {
+        gameOverTitle.load("Verdana.ttf", 12, true, true);
+        gameOverTitle.setLineHeight(34.0f);
+        gameOverTitle.setLetterSpacing(1.035);
+    });
+
+
+    // not needed until the first game ends, the loader brings its banner in last
+    auto gameOverBanner = std::make_shared<GameSprite>();
+    assets.addSprite(gameOverBanner, "game-over.png", ofGetWindowWidth(), ofGetWindowHeight());
+    gameManager->AddScene(GameSceneKind::GAME_OVER, std::make_shared<GameOverScene>(
+        GameSceneKindToString(GameSceneKind::GAME_OVER), std::move(gameOverBanner)
     ));
 
     ofSetLogLevel(OF_LOG_NOTICE); // Set default log level
+
+    AQ_LOG_NOTICE() << "startup: setup took " << (ofGetElapsedTimeMillis() - setupStart) << " ms, "
+                  << assets.total() << " assets loading" << std::endl;
 }
 
 //--------------------------------------------------------------
 void ofApp::update(){
-    
-    if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::GAME_OVER)){
+    Profiler::beginFrame();
+    PROFILE_ZONE("ofApp::update");
+
+    if (!assetsReported) {
+        assets.update(kAssetUploadBudgetMillis);
+        if (assets.isDone()) {
+            assetsReported = true;
+            AQ_LOG_NOTICE() << "startup: assets loaded after " << ofGetElapsedTimeMillis() << " ms, images "
+                          << ImageCache::loadMillis() << " ms (cache hits " << ImageCache::hits()
+                          << ", misses " << ImageCache::misses() << ")" << std::endl;
+        }
+    }
+
+    if(gameManager->IsActive(GameSceneKind::GAME_OVER)){
         return; // Stop updating if game is over or exiting
     }
 
-    if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
-        auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
-        if(gameScene->GetLastEvent() != nullptr && gameScene->GetLastEvent()->isGameOver()){
-            gameManager->Transition(GameSceneKindToString(GameSceneKind::GAME_OVER));
+    if(gameManager->IsActive(GameSceneKind::AQUARIUM_GAME)){
+        if(aquariumScene()->GetLastEvent().isGameOver()){
+            saveReplay();
+            gameManager->Transition(GameSceneKind::GAME_OVER);
             return;
         }
         
@@ -94,63 +123,113 @@ void ofApp::update(){
 
 //--------------------------------------------------------------
 void ofApp::draw(){
-    backgroundImage.draw(0, 0);
+    PROFILE_ZONE("ofApp::draw");
+    if (backgroundReady) backgroundImage.draw(0, 0);
     gameManager->DrawActiveScene();
+    if (!firstFrameDrawn) {
+        firstFrameDrawn = true;
+        AQ_LOG_NOTICE() << "startup: first frame after " << ofGetElapsedTimeMillis() << " ms" << std::endl;
+    }
 }
 
 //--------------------------------------------------------------
 void ofApp::exit(){
-    
+    saveReplay();
+    Log::flush(); // the writer thread may still hold the last lines
+}
+
+void ofApp::saveReplay(){
+    if (!recorder.isRecording()) return;
+    AquariumGameScene* gameScene = aquariumScene();
+    if (gameScene->GetTick() == 0) return; // never got past the intro
+
+    ofDirectory::createDirectory("replays", true, true);
+    std::string path = ofToDataPath("replays/aquarium-" + ofGetTimestampString("%Y%m%d-%H%M%S") + ".aqreplay", true);
+    uint64_t hash = hashGameState(*gameScene->GetAquarium(), *gameScene->GetPlayer());
+    if (recorder.finish(gameScene->GetTick(), hash, path)) {
+        AQ_LOG_NOTICE() << "replay saved to " << path << std::endl;
+    } else {
+        AQ_LOG_ERROR() << "could not save replay to " << path << std::endl;
+    }
+}
+
+// F5 / F9: one quick save slot in data/snapshots/
+void ofApp::quickSave(){
+    AquariumGameScene* gameScene = aquariumScene();
+    ofDirectory::createDirectory("snapshots", true, true);
+    std::string path = ofToDataPath("snapshots/quick.aqsnap", true);
+    if (AquariumSnapshot::save(*gameScene->GetAquarium(), *gameScene->GetPlayer(), path)) {
+        AQ_LOG_NOTICE() << "snapshot saved to " << path << std::endl;
+    } else {
+        AQ_LOG_ERROR() << "could not save snapshot to " << path << std::endl;
+    }
+}
+
+void ofApp::quickLoad(){
+    AquariumGameScene* gameScene = aquariumScene();
+    std::string path = ofToDataPath("snapshots/quick.aqsnap", true);
+    uint64_t start = ofGetElapsedTimeMillis();
+    if (!AquariumSnapshot::load(*gameScene->GetAquarium(), *gameScene->GetPlayer(), path)) {
+        AQ_LOG_ERROR() << "could not load snapshot " << path << std::endl;
+        return;
+    }
+    recorder.cancel(); // the seed no longer leads to this game
+    const int w = ofGetWidth(), h = ofGetHeight(); // the snapshot may come from another window size
+    WorldBounds::set(w, h);
+    gameScene->GetAquarium()->setBounds(w, h);
+    gameScene->GetPlayer()->setBounds(w - 20, h - 20);
+    AQ_LOG_NOTICE() << "snapshot loaded from " << path << " in " << (ofGetElapsedTimeMillis() - start) << " ms" << std::endl;
 }
 
 //--------------------------------------------------------------
 void ofApp::keyPressed(int key){
     if (key == 'm' || key == 'M') { // Toggle music on/off
         musicOn = !musicOn;
-        if (musicOn) {
+        if (!musicReady) {
+            // still loading on another thread, it starts with musicOn's volume when it is in
+        } else if (musicOn) {
             if (!bgm.isPlaying()) bgm.play(); // Resume music if it was stopped
             bgm.setVolume(0.5f);
         } else {
             bgm.setVolume(0.0f);  //  mute
         }
     }
+    if (key == 'p' || key == 'P') { // frame profiler overlay
+        aquariumScene()->SetProfilerOverlay(!aquariumScene()->IsProfilerOverlayVisible());
+        return;
+    }
+    if (key == 't' || key == 'T') { // dump the last frames for chrome://tracing
+        ofDirectory::createDirectory("traces", true, true);
+        std::string path = ofToDataPath("traces/frames-" + ofGetTimestampString("%Y%m%d-%H%M%S") + ".json", true);
+        if (Profiler::writeChromeTrace(path)) {
+            AQ_LOG_NOTICE() << "frame trace saved to " << path << std::endl;
+        } else {
+            AQ_LOG_ERROR() << "could not save frame trace to " << path << std::endl;
+        }
+        return;
+    }
     if (lastEvent.isGameExit()) { 
-        ofLogNotice() << "Game has ended. Press ESC to exit." << std::endl;
+        AQ_LOG_NOTICE() << "Game has ended. Press ESC to exit." << std::endl;
         return; // Ignore other keys after game over
     }
-    if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
-        auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
-        switch(key){
-            case OF_KEY_UP:
-                gameScene->GetPlayer()->setDirection(gameScene->GetPlayer()->isXDirectionActive()?gameScene->GetPlayer()->getDx():0, -1);
-                break;
-                case OF_KEY_DOWN:
-                gameScene->GetPlayer()->setDirection(gameScene->GetPlayer()->isXDirectionActive()?gameScene->GetPlayer()->getDx():0, 1);
-                break;
-            case OF_KEY_LEFT:
-                gameScene->GetPlayer()->setDirection(-1, gameScene->GetPlayer()->isYDirectionActive()?gameScene->GetPlayer()->getDy():0);
-                gameScene->GetPlayer()->setFlipped(true);
-                break;
-                case OF_KEY_RIGHT:
-                gameScene->GetPlayer()->setDirection(1, gameScene->GetPlayer()->isYDirectionActive()?gameScene->GetPlayer()->getDy():0);
-                gameScene->GetPlayer()->setFlipped(false);
-                break;
-            default:
-                break;
-        }
-    
-        
-    
-        gameScene->GetPlayer()->move();
+    if(gameManager->IsActive(GameSceneKind::AQUARIUM_GAME) && (key == OF_KEY_F5 || key == OF_KEY_F9)){
+        if (key == OF_KEY_F5) quickSave(); else quickLoad();
+        return;
+    }
+    if(gameManager->IsActive(GameSceneKind::AQUARIUM_GAME)){
+        AquariumGameScene* gameScene = aquariumScene();
+        recorder.keyPressed(gameScene->GetTick(), key);
+        gameScene->HandleKeyPressed(key);
         return;
 
     }
 
-    if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::GAME_INTRO)){
+    if(gameManager->IsActive(GameSceneKind::GAME_INTRO)){
         switch (key)
         {
         case OF_KEY_SPACEBAR:
-            gameManager->Transition(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME));
+            if (!assets.isDone()) break; // the fish would be invisible
+            gameManager->Transition(GameSceneKind::AQUARIUM_GAME);
             break;
         
         default:
@@ -165,20 +244,10 @@ void ofApp::keyPressed(int key){
 
 //--------------------------------------------------------------
 void ofApp::keyReleased(int key){
-    if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
-        auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
-    if( key == OF_KEY_UP || key == OF_KEY_DOWN){
-        gameScene->GetPlayer()->setDirection(gameScene->GetPlayer()->isXDirectionActive()?gameScene->GetPlayer()->getDx():0, 0);
-        gameScene->GetPlayer()->move();
-        return;
-    }
-    
-    if(key == OF_KEY_LEFT || key == OF_KEY_RIGHT){
-        gameScene->GetPlayer()->setDirection(0, gameScene->GetPlayer()->isYDirectionActive()?gameScene->GetPlayer()->getDy():0);
-        gameScene->GetPlayer()->move();
-        return;
-    }
-
+    if(gameManager->IsActive(GameSceneKind::AQUARIUM_GAME)){
+        AquariumGameScene* gameScene = aquariumScene();
+        recorder.keyReleased(gameScene->GetTick(), key);
+        gameScene->HandleKeyReleased(key);
     }
 }
 
@@ -219,10 +288,12 @@ void ofApp::mouseExited(int x, int y){
 
 //--------------------------------------------------------------
 void ofApp::windowResized(int w, int h){
-    backgroundImage.resize(w, h);
-    auto aquariumScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetScene(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)));
-    aquariumScene->GetAquarium()->setBounds(w,h);
-    aquariumScene->GetPlayer()->setBounds(w - 20, h - 20);
+    if (backgroundReady) backgroundImage.resize(w, h); // otherwise the loader still owns it
+    WorldBounds::set(w, h);
+    AquariumGameScene* gameScene = aquariumScene();
+    recorder.resized(gameScene->GetTick(), w, h);
+    gameScene->GetAquarium()->setBounds(w,h);
+    gameScene->GetPlayer()->setBounds(w - 20, h - 20);
 
 }
 
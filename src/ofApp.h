@@ -2,6 +2,10 @@
 
 #include "ofMain.h"
 #include "Aquarium.h"
+#include "Replay.h"
+#include "Profiler.h"
+#include "Log.h"
+#include "Snapshot.h"
 
 const int OF_KEY_SPACEBAR = ' '; // Define spacebar key constant
 
@@ -34,7 +38,7 @@ class ofApp : public ofBaseApp{
 	
 		
 		char moveDirection;
-		int DEFAULT_SPEED = 5;
+		int DEFAULT_SPEED = 5; // player_speed in settings.xml
 
 
 		AwaitFrames acuariumUpdate{5};
@@ -44,8 +48,24 @@ class ofApp : public ofBaseApp{
 
 
 		ofImage backgroundImage;
+		bool firstFrameDrawn = false;
+
+		InputRecorder recorder; // every game is recorded to data/replays/
+		void saveReplay();
+		void quickSave();
+		void quickLoad();
+
+		// images, music and the font load in the background while the intro shows progress
+		AssetLoader assets; // after what it loads into, so it is stopped before they go
+		bool backgroundReady = false;
+		bool musicReady = false;
+		bool assetsReported = false;
+		static constexpr double kAssetUploadBudgetMillis = 4.0; // per frame, for texture uploads
 
 		std::unique_ptr<GameSceneManager> gameManager;
 		std::shared_ptr<AquariumSpriteManager>spriteManager;
+		AquariumGameScene* aquariumScene() const {
+			return static_cast<AquariumGameScene*>(gameManager->GetScene(GameSceneKind::AQUARIUM_GAME).get());
+		}
 		
 };